@@ -0,0 +1,109 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts, which
+ * switches to timer sampling (Timer2, 2 kHz) when the edge rate is high
+ */ 
+
+#include <KY040Adaptive.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+KY040 *g_encoders[] = { &g_rotaryEncoder };
+// Window 100 ms, switch to timer sampling above 60 edges, back to pin change interrupts below 20 edges
+KY040Adaptive g_acquisition(g_encoders, 1, 100, 60, 20);
+
+// Rotary encoder value (will be set in ISR)
+volatile int v_value=0;
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// Process the CLK/DT state (used by both ISRs)
+void processRotaryEncoder() {
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  // Process stored state
+  switch (g_rotaryEncoder.checkRotation()) {
+    case KY040::CLOCKWISE:
+      v_value++;
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      v_value--;
+      break;
+  }
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  processRotaryEncoder();
+}
+
+// ISR for timer sampling
+ISR (TIMER2_COMPA_vect) {
+  processRotaryEncoder();
+}
+
+// Switch between pin change interrupt and timer sampling
+void setMode(byte mode) {
+  cli();
+  if (mode == KY040Adaptive::TIMER) {
+    PCICR &= ~bit(digitalPinToPCICRbit(CLK_PIN)); // disable pin change interrupt for the group
+    TCNT2 = 0;
+    TIFR2 = bit(OCF2A); // clear any outstanding interrupt
+    TIMSK2 |= bit(OCIE2A); // enable timer interrupt
+  } else {
+    TIMSK2 &= ~bit(OCIE2A); // disable timer interrupt
+    PCIFR = bit(digitalPinToPCICRbit(CLK_PIN)); // clear any outstanding interrupt
+    PCICR |= bit(digitalPinToPCICRbit(CLK_PIN)); // enable pin change interrupt for the group
+  }
+  // Process a change which could have happened while switching
+  processRotaryEncoder();
+  sei();
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Timer2 in CTC mode with 16 MHz/64/125 = 2 kHz, interrupt stays disabled until needed
+  TCCR2A = bit(WGM21);
+  TCCR2B = bit(CS22);
+  OCR2A = 124;
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static int lastValue = 0;
+  int value;
+
+  if (g_acquisition.update()) {
+    setMode(g_acquisition.getMode());
+    Serial.print(g_acquisition.getMode() == KY040Adaptive::TIMER ? "Timer" : "Pin change");
+    Serial.print(" mode, switches to timer/pin change: ");
+    Serial.print(g_acquisition.getSwitchesToTimer());
+    Serial.print("/");
+    Serial.println(g_acquisition.getSwitchesToPinChange());
+  }
+
+  // Get rotary encoder value set in ISR
+  cli();
+  value = v_value;
+  sei();
+
+  // Show, if value has changed
+  if (lastValue != value) {
+    Serial.println(value);
+    lastValue = value;
+  }
+}
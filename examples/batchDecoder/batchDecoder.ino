@@ -0,0 +1,60 @@
+/* 
+ * Example for sampling the rotary encoder in a timer ISR (Timer2, 2 kHz) 
+ * into a double buffer and decoding full buffers in the loop with the 
+ * maximum likelihood decoder KY040Batch
+ */ 
+
+#include <KY040Batch.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+
+// Costs: step 4, missed sample 12, one bit wrong 6, two bits wrong 14
+const KY040BatchModel c_model = { 4, 12, 6, 14 };
+KY040Batch g_decoder(c_model);
+
+#define SAMPLES 128
+byte g_samples[2][SAMPLES]; // Double buffer, filled in ISR
+volatile byte v_fillBuffer = 0; // Buffer filled by the ISR
+volatile byte v_fillIndex = 0;
+volatile bool v_bufferReady = false; // The other buffer is full
+byte g_work[SAMPLES];
+KY040BatchEvent g_events[KY040BATCHMAXEVENTS(SAMPLES)]; // Enough for all steps, even with missed samples
+
+// ISR for timer sampling
+ISR (TIMER2_COMPA_vect) {
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  g_samples[v_fillBuffer][v_fillIndex] = ((PIND & 0b00110000)>>4);
+  if (++v_fillIndex >= SAMPLES) { // Buffer full, switch buffers
+    v_fillIndex = 0;
+    v_fillBuffer ^= 1;
+    v_bufferReady = true;
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Timer2 in CTC mode with 16 MHz/64/125 = 2 kHz
+  TCCR2A = bit(WGM21);
+  TCCR2B = bit(CS22);
+  OCR2A = 124;
+  TIMSK2 |= bit(OCIE2A);
+}
+
+void loop() {
+  if (!v_bufferReady) return;
+
+  // Decode the buffer, which is not filled by the ISR (has to be finished within 64 ms)
+  byte buffer = v_fillBuffer ^ 1;
+  v_bufferReady = false;
+  size_t count = g_decoder.decode(g_samples[buffer], SAMPLES, g_work, g_events, KY040BATCHMAXEVENTS(SAMPLES));
+
+  for (size_t i=0;i<count;i++) {
+    Serial.print((g_events[i].direction == KY040::CLOCKWISE) ? "CW" : "CCW");
+    Serial.print(" confidence:");
+    Serial.print(g_events[i].confidence);
+    Serial.print(" position:");
+    Serial.println(g_decoder.getPosition());
+  }
+}
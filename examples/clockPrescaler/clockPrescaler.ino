@@ -0,0 +1,60 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts and a
+ * downclocked MCU (1 MHz instead of 16 MHz), while the rotary encoder is idle
+ */ 
+
+// Include KY040Clock.h before KY040.h (or define KY040_USE_CLOCK for the whole build), so the library uses the compensated time
+#include <KY040Clock.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+KY040 *g_rotaryEncoders[] = { &g_rotaryEncoder };
+KY040ClockPolicy g_clockPolicy(g_rotaryEncoders, 1, 4); // 16 MHz/2^4 = 1 MHz while idle
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  g_clockPolicy.wakeup(); // Full clock on the first edge
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  g_rotaryEncoder.checkRotation(); // Position is updated by the library
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static int lastPosition = 0;
+
+  // Show, if position has changed (Serial needs the full clock, which is restored by the ISR)
+  int position = g_rotaryEncoder.getPosition();
+  if (lastPosition != position) {
+    Serial.print(position);
+    Serial.print(" ms:");
+    Serial.print(KY040Clock::getMillis());
+    Serial.print(" downclocks:");
+    Serial.println(g_clockPolicy.getDownclockCount());
+    Serial.flush(); // Finish sending before downclocking
+    lastPosition = position;
+  }
+
+  // Downclock ~150 milliseconds after the last sequence start
+  g_clockPolicy.update();
+}
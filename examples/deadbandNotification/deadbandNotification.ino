@@ -0,0 +1,48 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts and a 
+ * deadband notification. The position is only "saved", when it has moved 
+ * at least 5 steps or was not changed for 2 seconds after a rotation
+ */ 
+
+#include <KY040.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Notify after 5 steps or 2000 milliseconds without rotation
+KY040Deadband g_saveNotification(5, 2000);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Process pin state, the position is updated by the library
+  g_rotaryEncoder.getRotation();
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  g_rotaryEncoder.attachDeadband(g_saveNotification);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  if (g_saveNotification.available()) {
+    // A slow consumer, for example writing to EEPROM, would be placed here
+    Serial.print("Save position ");
+    Serial.println(g_saveNotification.acknowledge());
+  }
+}
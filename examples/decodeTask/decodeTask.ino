@@ -0,0 +1,82 @@
+/* 
+ * Example for decoding two rotary encoders in a FreeRTOS task on an ESP32
+ * and showing the latency from the edge to the decoded state. Change the
+ * priority and core of the decode task and enable the CPU hog task to
+ * compare configurations under load.
+ */ 
+
+#include <KY040Task.h>
+
+// Rotary encoders
+const byte c_clkPins[] = { 32, 25 }; // aka. A
+const byte c_dtPins[] = { 33, 26 }; // aka. B
+KY040 g_rotaryEncoder1(c_clkPins[0],c_dtPins[0]);
+KY040 g_rotaryEncoder2(c_clkPins[1],c_dtPins[1]);
+
+KY040 *g_rotaryEncoders[] = { &g_rotaryEncoder1, &g_rotaryEncoder2 };
+KY040Task g_decoder(g_rotaryEncoders, c_clkPins, c_dtPins, 2);
+
+// Synthetic load: Comment out to run without CPU hog task
+#define CPUHOG
+
+#ifdef CPUHOG
+// Busy task with the priority of loop() on the core of the decode task
+void cpuHogTask(void *) {
+  for (;;) {
+    volatile unsigned long counter = 0;
+    for (unsigned long i=0;i<100000;i++) counter++;
+    vTaskDelay(1); // Let the idle task feed the watchdog
+  }
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+  // Without builtin pull up resistors for CLK/DT (the KY-040 module has them)
+  for (byte i=0;i<2;i++) {
+    pinMode(c_clkPins[i],INPUT_PULLUP);
+    pinMode(c_dtPins[i],INPUT_PULLUP);
+  }
+
+  // Decode task with priority 5 on core 1 (the core of loop())
+  if (!g_decoder.begin(5, 1)) Serial.println("Decode task could not be created");
+
+  #ifdef CPUHOG
+  xTaskCreatePinnedToCore(cpuHogTask, "cpuHog", 2048, NULL, 1, NULL, 1);
+  #endif
+}
+
+void loop() {
+  static int lastPositions[2];
+  static unsigned long lastReportMillis = 0;
+
+  for (byte i=0;i<2;i++) {
+    int position = g_decoder.getPosition(i); // Safe on any core, the decode task owns the KY040 objects
+    if (position != lastPositions[i]) {
+      Serial.print("Encoder ");
+      Serial.print(i);
+      Serial.print(":");
+      Serial.println(position);
+      lastPositions[i] = position;
+    }
+  }
+
+  // Report latency histogram every 10 seconds
+  if (millis() - lastReportMillis >= 10000) {
+    KY040Histogram latency;
+    g_decoder.getLatencyHistogram(latency, true); // Copy and reset
+    Serial.print("Edges:");
+    Serial.print(latency.getTotal());
+    Serial.print(" p50/p99/max us:");
+    Serial.print(latency.getPercentile(50));
+    Serial.print("/");
+    Serial.print(latency.getPercentile(99));
+    Serial.print("/");
+    Serial.print(latency.getMax());
+    Serial.print(" dropped:");
+    Serial.println(g_decoder.getDroppedCount());
+    lastReportMillis = millis();
+  }
+  delay(10);
+}
@@ -0,0 +1,137 @@
+/* 
+ * Benchmark for the decoders with synthetic CLK/DT traces (clean and bouncy).
+ * Shows CPU cycles for each call of checkRotation() (min/avg/max) and for
+ * each sample of KY040Batch. Cycles are counted with the CPU cycle counter on
+ * ESP32 and with Timer1 (no prescaler) on AVR. Without a cycle counter the
+ * cycles are calculated from micros() (only useful for the averages).
+ * No rotary encoder is needed.
+ */ 
+
+#include <KY040Batch.h>
+
+#if defined(ESP32)
+#define CYCLESOURCE "CPU cycle counter"
+unsigned long getCycles() { return ESP.getCycleCount(); }
+#elif defined(__AVR__)
+#define CYCLESOURCE "Timer1"
+// 16 bit, only for measurements shorter than 65536 cycles
+unsigned long getCycles() { return TCNT1; }
+#else
+#define CYCLESOURCE "micros() (no cycle counter)"
+unsigned long getCycles() { return micros() * (F_CPU / 1000000UL); }
+#endif
+
+// Time difference in cycles (with 16 bit overrun for Timer1)
+unsigned long cyclesSince(unsigned long start) {
+  #if defined(__AVR__)
+  return (unsigned int) (getCycles() - start);
+  #else
+  return getCycles() - start;
+  #endif
+}
+
+#define TRACESIZE 240
+byte g_trace[TRACESIZE];
+byte g_work[TRACESIZE];
+KY040BatchEvent g_events[KY040BATCHMAXEVENTS(TRACESIZE)];
+
+// Creates a trace of clockwise and counter-clockwise steps, each transition with bounces
+size_t createTrace(byte bounces) {
+  const byte c_sequenceCW[] = { 0b01, 0b00, 0b10, 0b11 };
+  size_t size = 0;
+  byte state = INITSTEP;
+  bool clockwise = true;
+  while (size + 4*(2*bounces+1) <= TRACESIZE) {
+    for (byte i=0;i<4;i++) {
+      byte next = clockwise ? c_sequenceCW[i] : c_sequenceCW[(6-i)%4];
+      for (byte j=0;j<bounces;j++) { // Bounce between the old and the new state
+        g_trace[size++] = next;
+        g_trace[size++] = state;
+      }
+      g_trace[size++] = next;
+      state = next;
+    }
+    clockwise = !clockwise;
+  }
+  return size;
+}
+
+// Measures checkRotation() for each sample of the trace
+void benchmarkCheckRotation(const char *name, size_t size) {
+  KY040 rotaryEncoder(2,3);
+  unsigned long minCycles = 0xFFFFFFFF;
+  unsigned long maxCycles = 0;
+  unsigned long sumCycles = 0;
+
+  // Measurement overhead
+  unsigned long start = getCycles();
+  unsigned long overhead = cyclesSince(start);
+
+  for (size_t i=0;i<size;i++) {
+    noInterrupts();
+    start = getCycles();
+    rotaryEncoder.setState(g_trace[i]);
+    rotaryEncoder.checkRotation();
+    unsigned long cycles = cyclesSince(start);
+    interrupts();
+    cycles = (cycles > overhead) ? cycles - overhead : 0;
+    if (cycles < minCycles) minCycles = cycles;
+    if (cycles > maxCycles) maxCycles = cycles;
+    sumCycles += cycles;
+  }
+  Serial.print(name);
+  Serial.print(" checkRotation() cycles min/avg/max:");
+  Serial.print(minCycles);
+  Serial.print("/");
+  Serial.print(sumCycles / size);
+  Serial.print("/");
+  Serial.print(maxCycles);
+  Serial.print(" position:");
+  Serial.println(rotaryEncoder.getPosition());
+}
+
+// Measures KY040Batch for the whole trace
+void benchmarkBatch(const char *name, size_t size) {
+  const KY040BatchModel c_model = { 4, 12, 6, 14 };
+  KY040Batch decoder(c_model);
+
+  #if defined(__AVR__)
+  // Timer1 would overrun, so the whole trace is measured with micros()
+  unsigned long start = micros();
+  decoder.decode(g_trace, size, g_work, g_events, KY040BATCHMAXEVENTS(TRACESIZE));
+  unsigned long cycles = (micros() - start) * (F_CPU / 1000000UL);
+  #else
+  unsigned long start = getCycles();
+  decoder.decode(g_trace, size, g_work, g_events, KY040BATCHMAXEVENTS(TRACESIZE));
+  unsigned long cycles = cyclesSince(start);
+  #endif
+  Serial.print(name);
+  Serial.print(" KY040Batch cycles per sample:");
+  Serial.print(cycles / size);
+  Serial.print(" position:");
+  Serial.println(decoder.getPosition());
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  #if defined(__AVR__)
+  // Timer1 in normal mode with the CPU clock
+  TCCR1A = 0;
+  TCCR1B = bit(CS10);
+  #endif
+
+  Serial.print("Cycles from ");
+  Serial.println(CYCLESOURCE);
+
+  size_t size = createTrace(0);
+  benchmarkCheckRotation("Clean trace", size);
+  benchmarkBatch("Clean trace", size);
+
+  size = createTrace(3);
+  benchmarkCheckRotation("Bouncy trace", size);
+  benchmarkBatch("Bouncy trace", size);
+}
+
+void loop() {
+}
@@ -0,0 +1,48 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts and 
+ * showing the position with quarter steps, for example to animate 
+ * a knob on a display between two steps
+ */ 
+
+#include <KY040.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Process pin state, the position is updated by the library
+  g_rotaryEncoder.getRotation();
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static long lastPositionFixed = 0;
+
+  // Position with two fractional bits (quarter steps)
+  long positionFixed = g_rotaryEncoder.getPositionFixed();
+
+  // Show, if value has changed
+  if (lastPositionFixed != positionFixed) {
+    Serial.println(positionFixed / 4.0);
+    lastPositionFixed = positionFixed;
+  }
+}
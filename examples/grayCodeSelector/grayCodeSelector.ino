@@ -0,0 +1,74 @@
+/* 
+ * Example for using a rotary encoder and a 4-bit Gray code rotary switch
+ * (16 positions, common pin to ground) with pin change interrupts
+ */ 
+
+#include <KY040GrayCode.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Gray code rotary switch on D8 to D11 (PB0 to PB3)
+#define GRAY_FIRST_PIN 8
+KY040GrayCode g_selector(4, 0);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Process pin state, the position is updated by the library
+  g_rotaryEncoder.getRotation();
+}
+
+// ISR to handle pin change interrupt for D8 to D13 here
+ISR (PCINT0_vect) { 
+  g_selector.setState(PINB); // Store raw port value
+  g_selector.checkPosition(); // Process stored value
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  for (byte i=0;i<4;i++) {
+    pinMode(GRAY_FIRST_PIN + i, INPUT_PULLUP);
+    pciSetup(GRAY_FIRST_PIN + i);
+  }
+
+  // Synchronize with the current pin states
+  g_rotaryEncoder.begin();
+  g_selector.begin(PINB);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static int lastValue = 0;
+  static byte lastSelection = 0;
+
+  // Resync, when positions were missed (accepted after KY040GRAYRESYNCSAMPLES equal samples)
+  cli();
+  g_selector.setState(PINB);
+  g_selector.checkPosition();
+  sei();
+
+  int value = g_rotaryEncoder.getPosition();
+  byte selection = g_selector.getPosition();
+
+  // Show, if value or selection has changed
+  if ((lastValue != value) || (lastSelection != selection)) {
+    Serial.print("Selection:");
+    Serial.print(selection);
+    Serial.print(" Value:");
+    Serial.println(value);
+    lastValue = value;
+    lastSelection = selection;
+  }
+}
@@ -0,0 +1,72 @@
+/* 
+ * Example for measuring the latency from the end of a rotary encoder step
+ * (in the pin change ISR) to the reaction in the loop
+ */ 
+
+#include <KY040.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Latencies in microseconds
+KY040Histogram g_latency;
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  g_rotaryEncoder.checkRotation(); // Last rotation and its timestamp are stored by the library
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Record the latency from each step to its first read by getAndResetLastRotation() (or getPosition())
+  g_rotaryEncoder.attachLatencyHistogram(g_latency);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static unsigned long lastReportMillis = 0;
+
+  switch (g_rotaryEncoder.getAndResetLastRotation()) {
+    case KY040::CLOCKWISE:
+      Serial.println("CW");
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      Serial.println("CCW");
+      break;
+  }
+
+  // Simulated work in the loop
+  delay(5);
+
+  // Report latencies every 10 seconds
+  if (millis() - lastReportMillis >= 10000) {
+    Serial.print("Steps:");
+    Serial.print(g_latency.getTotal());
+    Serial.print(" latency p50/p99/max us:");
+    Serial.print(g_latency.getPercentile(50));
+    Serial.print("/");
+    Serial.print(g_latency.getPercentile(99));
+    Serial.print("/");
+    Serial.println(g_latency.getMax());
+    g_latency.reset();
+    lastReportMillis = millis();
+  }
+}
@@ -0,0 +1,67 @@
+/* 
+ * Example for two rotary encoders with pin change interrupts and two 
+ * 16-LED rings on a chain of four 74HC595 shift registers (SPI)
+ */ 
+
+#include <SPI.h>
+#include <KY040LedRing.h>
+
+// First rotary encoder
+#define X_CLK_PIN 5 // aka. A
+#define X_DT_PIN 4 // aka. B
+KY040 g_rotaryEncoderX(X_CLK_PIN,X_DT_PIN);
+
+// Second rotary encoder
+#define Y_CLK_PIN 7 // aka. A
+#define Y_DT_PIN 6 // aka. B
+KY040 g_rotaryEncoderY(Y_CLK_PIN,Y_DT_PIN);
+
+// Latch pin (RCLK) of the 74HC595 chain. SER and SRCLK are connected to MOSI (D11) and SCK (D13)
+#define LATCH_PIN 10
+
+// Two rings with 16 LEDs
+KY040LedRing<SPIClass, 2, 16> g_ledRings(SPI, LATCH_PIN);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupts for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Read pin states with PIND (Faster replacement for digitalRead, better for fast interrupts, but harder to read)
+  byte state = PIND;
+
+  // Process both rotary encoders, the positions are updated by the library
+  g_rotaryEncoderX.setState((state & 0b00110000)>>4);
+  g_rotaryEncoderX.checkRotation();
+  g_rotaryEncoderY.setState((state & 0b11000000)>>6);
+  g_rotaryEncoderY.checkRotation();
+}
+
+void setup() {
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(8000000, LSBFIRST, SPI_MODE0));
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoderX.begin();
+  g_rotaryEncoderY.begin();
+
+  // First ring as a bar for positions 0..100, second ring as a dot for endless rotation
+  g_ledRings.attach(0, g_rotaryEncoderX, KY040LedRing<SPIClass, 2, 16>::BAR, 0, 100);
+  g_ledRings.attach(1, g_rotaryEncoderY, KY040LedRing<SPIClass, 2, 16>::WRAP);
+  g_ledRings.begin();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(X_CLK_PIN);
+  pciSetup(X_DT_PIN);
+  pciSetup(Y_CLK_PIN);
+  pciSetup(Y_DT_PIN);
+}
+
+void loop() {
+  // Shifts out only, when a ring has changed
+  g_ledRings.update();
+}
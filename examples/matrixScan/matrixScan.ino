@@ -0,0 +1,66 @@
+/* 
+ * Example for scanning 16 rotary encoders in a diode matrix with 4 groups
+ * of 4 rotary encoders in a timer ISR (Timer2, 4 kHz => 1 kHz for each group)
+ */ 
+
+#include <KY040Matrix.h>
+
+// Strobe outputs, one for each group
+const byte c_strobePins[] = { A0, A1, A2, A3 };
+
+// Shared return lines, one CLK/DT pair for each rotary encoder of a group
+const byte c_clkPins[] = { 2, 4, 6, 8 };
+const byte c_dtPins[] = { 3, 5, 7, 9 };
+
+// Rotary encoders (constructed with the return lines of their column)
+KY040 g_rotaryEncoders[] = {
+  KY040(2,3), KY040(4,5), KY040(6,7), KY040(8,9), // Group 0
+  KY040(2,3), KY040(4,5), KY040(6,7), KY040(8,9), // Group 1
+  KY040(2,3), KY040(4,5), KY040(6,7), KY040(8,9), // Group 2
+  KY040(2,3), KY040(4,5), KY040(6,7), KY040(8,9)  // Group 3
+};
+
+KY040Matrix g_matrix(c_strobePins, 4, c_clkPins, c_dtPins, 4, g_rotaryEncoders);
+
+// ISR for the matrix scan
+ISR (TIMER2_COMPA_vect) {
+  g_matrix.scan();
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  g_matrix.begin();
+
+  // Timer2 in CTC mode with 16 MHz/64/(61+1) = about 4 kHz
+  TCCR2A = bit(WGM21);
+  TCCR2B = bit(CS22);
+  OCR2A = 61;
+  TIMSK2 |= bit(OCIE2A);
+}
+
+void loop() {
+  static int lastPositions[16];
+  static unsigned long lastReportMillis = 0;
+
+  for (byte i=0;i<16;i++) {
+    int position = g_rotaryEncoders[i].getPosition();
+    if (position != lastPositions[i]) {
+      Serial.print("Encoder ");
+      Serial.print(i);
+      Serial.print(":");
+      Serial.println(position);
+      lastPositions[i] = position;
+    }
+  }
+
+  // Report scan rate and decode cost every 5 seconds
+  if (millis() - lastReportMillis >= 5000) {
+    unsigned long scans = g_matrix.getAndResetScanCount();
+    Serial.print("Scans per second and group:");
+    Serial.print(scans * 1000 / (millis() - lastReportMillis) / 4);
+    Serial.print(" Max. scan us:");
+    Serial.println(g_matrix.getAndResetMaxScanMicros());
+    lastReportMillis = millis();
+  }
+}
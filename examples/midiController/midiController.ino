@@ -0,0 +1,61 @@
+/* 
+ * Example for a MIDI controller with two rotary encoders and pin change 
+ * interrupts. Each rotary encoder sends relative Control Change messages 
+ * with merged steps and running status on the serial port (31250 baud)
+ */ 
+
+#include <KY040Midi.h>
+
+// First rotary encoder
+#define X_CLK_PIN 5 // aka. A
+#define X_DT_PIN 4 // aka. B
+KY040 g_rotaryEncoderX(X_CLK_PIN,X_DT_PIN);
+
+// Second rotary encoder
+#define Y_CLK_PIN 7 // aka. A
+#define Y_DT_PIN 6 // aka. B
+KY040 g_rotaryEncoderY(Y_CLK_PIN,Y_DT_PIN);
+
+// Offset-64 encoding, at most one message per rotary encoder every 10 milliseconds
+KY040Midi g_midi(Serial, KY040Midi::OFFSET64, 10);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupts for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Read pin states with PIND (Faster replacement for digitalRead, better for fast interrupts, but harder to read)
+  byte state = PIND;
+
+  // Process both rotary encoders, the positions are updated by the library
+  g_rotaryEncoderX.setState((state & 0b00110000)>>4);
+  g_rotaryEncoderX.checkRotation();
+  g_rotaryEncoderY.setState((state & 0b11000000)>>6);
+  g_rotaryEncoderY.checkRotation();
+}
+
+void setup() {
+  Serial.begin(31250); // MIDI baud rate
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoderX.begin();
+  g_rotaryEncoderY.begin();
+
+  // MIDI channel 1 (0), controllers 16 and 17
+  g_midi.attach(g_rotaryEncoderX, 0, 16);
+  g_midi.attach(g_rotaryEncoderY, 0, 17);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(X_CLK_PIN);
+  pciSetup(X_DT_PIN);
+  pciSetup(Y_CLK_PIN);
+  pciSetup(Y_DT_PIN);
+}
+
+void loop() {
+  g_midi.update();
+}
@@ -0,0 +1,35 @@
+/* 
+ * Example for using the rotary encoder with a pulse counter unit (PCNT)
+ * of an ESP32. The edges are counted by hardware, the loop only reads the
+ * position.
+ */ 
+
+#include <KY040PCNT.h>
+
+#define CLK_PIN 32 // aka. A
+#define DT_PIN 33 // aka. B
+KY040PCNT g_rotaryEncoder(CLK_PIN,DT_PIN,PCNT_UNIT_0);
+
+void setup() {
+  Serial.begin(115200);
+
+  // Without builtin pull up resistors for CLK/DT (the KY-040 module has them)
+  pinMode(CLK_PIN,INPUT_PULLUP);
+  pinMode(DT_PIN,INPUT_PULLUP);
+
+  if (!g_rotaryEncoder.begin()) Serial.println("PCNT configuration failed");
+}
+
+void loop() {
+  static long lastPosition = 0;
+
+  // Show, if position has changed
+  long position = g_rotaryEncoder.getPosition();
+  if (lastPosition != position) {
+    Serial.print(position);
+    Serial.print(" realigned:");
+    Serial.println(g_rotaryEncoder.getRealignedCount());
+    lastPosition = position;
+  }
+  delay(10);
+}
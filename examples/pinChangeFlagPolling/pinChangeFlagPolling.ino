@@ -0,0 +1,68 @@
+/* 
+ * Example for using two rotary encoders without interrupts in polling mode,
+ * but only reading the pins when the pin change flag (PCIFR) was set
+ */ 
+
+#include <KY040.h>
+
+// First rotary encoder
+#define X_CLK_PIN 5 // aka. A
+#define X_DT_PIN 4 // aka. B
+KY040 g_rotaryEncoderX(X_CLK_PIN,X_DT_PIN);
+
+// Second rotary encoder
+#define Y_CLK_PIN 7 // aka. A
+#define Y_DT_PIN 6 // aka. B
+KY040 g_rotaryEncoderY(Y_CLK_PIN,Y_DT_PIN);
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoderX.begin();
+  g_rotaryEncoderY.begin();
+
+  // Enable pin change flags for CLK and DT (the pin change interrupts stay disabled)
+  g_rotaryEncoderX.enablePinChangeFlags();
+  g_rotaryEncoderY.enablePinChangeFlags();
+}
+
+void loop() {
+  static int lastValueX = 0;
+  static int lastValueY = 0;
+  static int valueX = 0;
+  static int valueY = 0;
+
+  // One read of PCIFR instead of four digitalRead() when nothing has changed
+  byte pinChangeFlags = KY040::getAndResetPinChangeFlags();
+
+  // Process first rotary encoder
+  switch (g_rotaryEncoderX.getRotation(pinChangeFlags)) {
+    case KY040::CLOCKWISE:
+      valueX++;
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      valueX--;
+      break;
+  }
+
+  // Process second rotary encoder
+  switch (g_rotaryEncoderY.getRotation(pinChangeFlags)) {
+    case KY040::CLOCKWISE:
+      valueY++;
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      valueY--;
+      break;
+  }
+
+  // Show, if value has changed
+  if ((lastValueX != valueX) || (lastValueY != valueY)) {
+    Serial.print("X:");
+    Serial.print(valueX);
+    Serial.print(" Y:");
+    Serial.println(valueY);
+    lastValueX = valueX;
+    lastValueY = valueY;
+  }
+}
\ No newline at end of file
@@ -34,6 +34,9 @@ ISR (PCINT2_vect) {
 void setup() {
   Serial.begin(9600);
 
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
   // Set pin change interrupt for CLK and DT
   pciSetup(CLK_PIN);
   pciSetup(DT_PIN);
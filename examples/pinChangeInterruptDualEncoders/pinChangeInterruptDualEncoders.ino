@@ -60,6 +60,10 @@ ISR (PCINT2_vect) {
 void setup() {
   Serial.begin(9600);
 
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoderX.begin();
+  g_rotaryEncoderY.begin();
+
   // Set pin change interrupt for CLK and DT
   pciSetup(X_CLK_PIN);
   pciSetup(X_DT_PIN);
@@ -14,6 +14,9 @@ void setup() {
   // If your rotary encoder has no builtin pullup resistors for CLK (aka. A) and DT (aka. B) uncomment the following two lines
   // pinMode(CLK_PIN,INPUT_PULLUP);
   // pinMode(DT_PIN,INPUT_PULLUP);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
 }
 
 void loop() {
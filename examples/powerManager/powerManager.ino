@@ -0,0 +1,61 @@
+/* 
+ * Example for graduated sleep modes with pin change interrupts:
+ * SLEEP_MODE_IDLE while the rotary encoder is in a running sequence and
+ * SLEEP_MODE_PWR_DOWN otherwise
+ */ 
+
+#include <KY040Power.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+KY040 *g_rotaryEncoders[] = { &g_rotaryEncoder };
+KY040Power g_power(g_rotaryEncoders, 1, SLEEP_MODE_PWR_DOWN);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  g_rotaryEncoder.checkRotation(); // Position is updated by the library
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static int lastPosition = 0;
+
+  // Sleep until the next interrupt (pin change or Timer0 in SLEEP_MODE_IDLE)
+  g_power.sleep();
+
+  // Show, if position has changed
+  int position = g_rotaryEncoder.getPosition();
+  if (lastPosition != position) {
+    Serial.print(position);
+    Serial.print(" running/idle ms:");
+    Serial.print(g_power.getMillisInMode(KY040Power::RUNNING));
+    Serial.print("/");
+    Serial.print(g_power.getMillisInMode(KY040Power::LIGHTSLEEP));
+    Serial.print(" deep sleeps:");
+    Serial.println(g_power.getCount(KY040Power::DEEPSLEEP));
+    Serial.flush(); // Finish sending before the next deep sleep
+    lastPosition = position;
+  }
+}
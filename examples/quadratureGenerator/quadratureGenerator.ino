@@ -0,0 +1,118 @@
+/*
+ * Example for a quadrature output generator in a timer ISR (Timer2, 10 kHz)
+ * with a loopback test: the generated CLK/DT signals are decoded by a KY040
+ * object in a pin change ISR, without a rotary encoder.
+ *
+ * Wiring: Connect pin 6 (generator CLK) to pin 5 (decoder CLK) and pin 7
+ * (generator DT) to pin 4 (decoder DT)
+ */
+
+#include <KY040Generator.h>
+
+#define GENERATOR_CLK_PIN 6
+#define GENERATOR_DT_PIN 7
+#define TICKMICROS 100 // Timer2 period
+KY040Generator g_generator(GENERATOR_CLK_PIN,GENERATOR_DT_PIN,TICKMICROS);
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Time between two decoded steps of a move
+volatile unsigned long v_lastStepMicros = 0;
+volatile unsigned long v_minStepMicros = 0xFFFFFFFF;
+volatile unsigned long v_maxStepMicros = 0;
+volatile bool v_moving = false;
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR for the generator
+ISR (TIMER2_COMPA_vect) {
+  g_generator.tick();
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here (only pin 4 and 5 are enabled)
+ISR (PCINT2_vect) {
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  byte result = g_rotaryEncoder.checkRotation(); // Position is updated by the library
+  if ((result == KY040::CLOCKWISE) || (result == KY040::COUNTERCLOCKWISE)) {
+    unsigned long currentMicros = micros();
+    if (v_moving) { // Not the first step of a move
+      unsigned long stepMicros = currentMicros - v_lastStepMicros;
+      if (stepMicros < v_minStepMicros) v_minStepMicros = stepMicros;
+      if (stepMicros > v_maxStepMicros) v_maxStepMicros = stepMicros;
+    }
+    v_lastStepMicros = currentMicros;
+    v_moving = true;
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_generator.begin();
+  g_rotaryEncoder.begin();
+
+  // Max. 200 steps per second
+  g_generator.setMaxStepRate(200);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+
+  // Timer2 in CTC mode with 16 MHz/8/200 = 10 kHz
+  TCCR2A = bit(WGM21);
+  TCCR2B = bit(CS21);
+  OCR2A = 199;
+  TIMSK2 |= bit(OCIE2A);
+}
+
+void loop() {
+  static byte s_round = 0;
+
+  // Every second round with bounces (two bounces after 30% of the edges)
+  if (s_round & 1) g_generator.setBounce(2,30); else g_generator.setBounce(0,0);
+
+  int target = random(-50,51);
+  unsigned int rejectedCount = g_rotaryEncoder.getRejectedCount();
+  cli();
+  v_moving = false;
+  v_minStepMicros = 0xFFFFFFFF;
+  v_maxStepMicros = 0;
+  sei();
+  g_generator.setTarget(target);
+  while (!g_generator.isIdle());
+  delay(10); // Last edge has reached the decoder
+
+  cli();
+  unsigned long minStepMicros = v_minStepMicros;
+  unsigned long maxStepMicros = v_maxStepMicros;
+  sei();
+  int position = g_rotaryEncoder.getPosition();
+  Serial.print((position == target) ? "OK" : "ERROR");
+  Serial.print(" target:");
+  Serial.print(target);
+  Serial.print(" decoded:");
+  Serial.print(position);
+  Serial.print(" rejected:");
+  Serial.print(g_rotaryEncoder.getRejectedCount() - rejectedCount);
+  Serial.print(" step rate:");
+  Serial.print(g_generator.getStepRate());
+  if (maxStepMicros > 0) {
+    Serial.print(" step time min/max us:");
+    Serial.print(minStepMicros);
+    Serial.print('/');
+    Serial.print(maxStepMicros);
+  }
+  Serial.println();
+  s_round++;
+  delay(1000);
+}
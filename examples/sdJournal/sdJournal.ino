@@ -0,0 +1,88 @@
+/* 
+ * Example for a journal of all rotary encoder steps on a SD card. The steps
+ * are added in the pin change ISR and written as 512 byte blocks in the loop.
+ *
+ * Caution: The journal writes raw blocks to the SD card and destroys a file
+ * system on it. Use a dedicated SD card.
+ */ 
+
+#include <SPI.h>
+#include <SD.h>
+#include <KY040Journal.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Rotary encoder value (will be set in ISR)
+volatile int v_value=0;
+
+#define SD_CS_PIN 10
+Sd2Card g_card;
+
+// Journal with 1000 blocks from block 2048, partially filled blocks are written after 5 seconds
+KY040Journal<Sd2Card> g_journal(g_card, 2048, 1000, 5000);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Faster replacement for digitalRead, better for interrupts, but harder to read
+  byte state = ((PIND & 0b00110000)>>4);
+  g_rotaryEncoder.setState(state); // Store CLK/DT states
+  // Process stored state
+  switch (g_rotaryEncoder.checkRotation()) {
+    case KY040::CLOCKWISE:
+      v_value++;
+      g_journal.add(0, v_value, KY040::CLOCKWISE);
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      v_value--;
+      g_journal.add(0, v_value, KY040::COUNTERCLOCKWISE);
+      break;
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  if (!g_card.init(SPI_HALF_SPEED, SD_CS_PIN)) {
+    Serial.println("SD card initialization failed");
+    while (true);
+  }
+
+  // Continue after the last completely written block
+  if (!g_journal.begin()) {
+    Serial.println("Journal could not be read");
+    while (true);
+  }
+  Serial.print("Next block sequence:");
+  Serial.println(g_journal.getSequence());
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  static unsigned long lastWrittenBlocks = 0;
+
+  // Write full blocks and partially filled blocks after the timeout
+  if (!g_journal.update()) Serial.println("Write error");
+
+  if (g_journal.getWrittenBlockCount() != lastWrittenBlocks) {
+    lastWrittenBlocks = g_journal.getWrittenBlockCount();
+    Serial.print("Blocks written:");
+    Serial.print(lastWrittenBlocks);
+    Serial.print(" dropped steps:");
+    Serial.println(g_journal.getDroppedCount());
+  }
+}
@@ -0,0 +1,47 @@
+/* 
+ * Example for mirroring the positions of four rotary encoders on a remote
+ * device with delta compressed state sync frames over Serial.
+ * Each frame is sent with a leading size byte, the receiver (for example a
+ * PC program with KY040SyncDecoder) answers with the sequence number of each
+ * decoded frame.
+ */ 
+
+#include <KY040Sync.h>
+
+KY040 g_rotaryEncoder1(2,3);
+KY040 g_rotaryEncoder2(4,5);
+KY040 g_rotaryEncoder3(6,7);
+KY040 g_rotaryEncoder4(8,9);
+
+KY040 *g_rotaryEncoders[] = { &g_rotaryEncoder1, &g_rotaryEncoder2, &g_rotaryEncoder3, &g_rotaryEncoder4 };
+
+// Keyframe each second, resend unacknowledged frames after 200 ms
+KY040SyncEncoder<4> g_sync(g_rotaryEncoders, 1000, 200);
+
+void setup() {
+  Serial.begin(115200);
+
+  // Synchronize with the current CLK/DT pin states
+  for (byte i=0;i<4;i++) g_rotaryEncoders[i]->begin();
+}
+
+void loop() {
+  static unsigned long lastFrameMillis = 0;
+  static byte frame[KY040SYNCMAXFRAMESIZE(4)];
+
+  // Poll rotary encoders, the positions are updated by the library
+  for (byte i=0;i<4;i++) g_rotaryEncoders[i]->getRotation();
+
+  // Acknowledges from the receiver
+  while (Serial.available() > 0) g_sync.acknowledge(Serial.read());
+
+  // Send at most one frame each 50 ms
+  if (millis() - lastFrameMillis >= 50) {
+    lastFrameMillis = millis();
+    size_t size = g_sync.encode(frame);
+    if (size > 0) {
+      Serial.write((byte) size);
+      Serial.write(frame, size);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+/* 
+ * Example for using two rotary encoders in polling mode with a 
+ * shared timer wheel for "knob released" notifications
+ */ 
+
+#include <KY040TimerWheel.h>
+
+// First rotary encoder
+#define X_CLK_PIN 5 // aka. A
+#define X_DT_PIN 4 // aka. B
+KY040 g_rotaryEncoderX(X_CLK_PIN,X_DT_PIN);
+
+// Second rotary encoder
+#define Y_CLK_PIN 7 // aka. A
+#define Y_DT_PIN 6 // aka. B
+KY040 g_rotaryEncoderY(Y_CLK_PIN,Y_DT_PIN);
+
+// Notify when a rotary encoder was not turned for 500 milliseconds
+#define RELEASEMS 500
+
+// Timer wheel with 10 milliseconds resolution
+KY040TimerWheel g_timerWheel(10);
+
+// Called from the timer wheel, when a rotary encoder was released
+void released(void *context) {
+  Serial.print((const char *) context);
+  Serial.println(" released");
+}
+
+// Restarted by update() after each finished step of the rotary encoder
+KY040ReleaseTimer g_releaseTimerX(g_rotaryEncoderX, RELEASEMS, released, (void *) "X");
+KY040ReleaseTimer g_releaseTimerY(g_rotaryEncoderY, RELEASEMS, released, (void *) "Y");
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoderX.begin();
+  g_rotaryEncoderY.begin();
+}
+
+void loop() {
+  static int valueX = 0;
+  static int valueY = 0;
+
+  // Process first rotary encoder
+  switch (g_rotaryEncoderX.getRotation()) {
+    case KY040::CLOCKWISE:
+      valueX++;
+      Serial.print("X:");
+      Serial.println(valueX);
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      valueX--;
+      Serial.print("X:");
+      Serial.println(valueX);
+      break;
+  }
+
+  // Process second rotary encoder
+  switch (g_rotaryEncoderY.getRotation()) {
+    case KY040::CLOCKWISE:
+      valueY++;
+      Serial.print("Y:");
+      Serial.println(valueY);
+      break;
+    case KY040::COUNTERCLOCKWISE:
+      valueY--;
+      Serial.print("Y:");
+      Serial.println(valueY);
+      break;
+  }
+
+  // Restart the release timers after finished steps
+  g_releaseTimerX.update(g_timerWheel);
+  g_releaseTimerY.update(g_timerWheel);
+
+  // Runs only the callbacks of expired timers
+  g_timerWheel.advance();
+}
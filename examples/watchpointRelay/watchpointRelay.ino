@@ -0,0 +1,63 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts and 
+ * watchpoints. A relay is switched on directly in the ISR, when the 
+ * position reaches the setpoint, and switched off, when the position 
+ * falls below the setpoint
+ */ 
+
+#include <KY040.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+#define RELAY_PIN 8
+
+// Watchpoint values (sorted when attached)
+int g_values[] = { 20, 10 };
+
+// Called inside the ISR, when a watchpoint was crossed
+void crossed(byte index, byte direction) {
+  // Sorted index 1 is the value 20
+  if (index == 1) digitalWrite(RELAY_PIN, (direction == KY040::CLOCKWISE) ? HIGH : LOW);
+}
+
+KY040Watchpoints g_watchpoints(g_values, 2, crossed);
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  // Process pin state, the position and watchpoints are updated by the library
+  g_rotaryEncoder.getRotation();
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+  pinMode(RELAY_PIN, OUTPUT);
+
+  g_rotaryEncoder.attachWatchpoints(g_watchpoints);
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  // Flags for crossed watchpoints without a callback
+  unsigned long crossed = g_watchpoints.getAndResetCrossed();
+  if (crossed & bit(0)) {
+    Serial.print("Watchpoint ");
+    Serial.print(g_watchpoints.getValue(0));
+    Serial.print(" crossed, position ");
+    Serial.println(g_rotaryEncoder.getPosition());
+  }
+}
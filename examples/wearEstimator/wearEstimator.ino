@@ -0,0 +1,87 @@
+/* 
+ * Example for using the rotary encoder with pin change interrupts and 
+ * lifetime counters with wear trend, which are saved round-robin in 
+ * EEPROM slots to spread the writes
+ */ 
+
+#include <EEPROM.h>
+#include <KY040Wear.h>
+
+#define CLK_PIN 5 // aka. A
+#define DT_PIN 4 // aka. B
+KY040 g_rotaryEncoder(CLK_PIN,DT_PIN);
+
+// Windows of 200 steps, worn at 1.5 bounces per step (384 = 1.5*256), save every 50 windows
+KY040Wear g_wear(g_rotaryEncoder, 200, 384, 50);
+
+// Number of EEPROM slots for the records
+#define SLOTS 16
+byte g_nextSlot = 0;
+
+// Enable pin change interrupt
+void pciSetup(byte pin) {
+  *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
+  PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
+  PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+}
+
+// ISR to handle pin change interrupt for D0 to D7 here
+ISR (PCINT2_vect) { 
+  g_rotaryEncoder.getRotation();
+}
+
+// Restore the newest valid record from the EEPROM slots
+void restoreRecord() {
+  KY040WearRecord record;
+  bool found = false;
+  unsigned int newestSequence = 0;
+  byte newestSlot = 0;
+
+  for (byte i=0;i<SLOTS;i++) {
+    EEPROM.get(i*sizeof(KY040WearRecord), record);
+    if (!g_wear.restore(record)) continue;
+    // Difference handles the overrun of the sequence number
+    if (!found || ((int) (record.sequence - newestSequence) > 0)) {
+      newestSequence = record.sequence;
+      newestSlot = i;
+      found = true;
+    }
+  }
+  if (found) {
+    EEPROM.get(newestSlot*sizeof(KY040WearRecord), record);
+    g_wear.restore(record);
+    g_nextSlot = (newestSlot + 1) % SLOTS;
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
+  restoreRecord();
+
+  // Set pin change interrupt for CLK and DT
+  pciSetup(CLK_PIN);
+  pciSetup(DT_PIN);
+}
+
+void loop() {
+  g_wear.update();
+
+  if (g_wear.saveNeeded()) {
+    KY040WearRecord record;
+    g_wear.getRecord(record);
+    EEPROM.put(g_nextSlot*sizeof(KY040WearRecord), record);
+    g_nextSlot = (g_nextSlot + 1) % SLOTS;
+
+    Serial.print("Steps:");
+    Serial.print(record.steps);
+    Serial.print(" Bounces per step:");
+    Serial.print(record.bouncesPerStep / 256.0);
+    Serial.print(" Remaining steps:");
+    unsigned long remaining = g_wear.getRemainingSteps();
+    if (remaining == KY040WEARUNKNOWN) Serial.println("unknown"); else Serial.println(remaining);
+  }
+}
@@ -29,6 +29,9 @@ void ISR_rotaryEncoder() {
 void setup() {
   Serial.begin(9600);
 
+  // Synchronize with the current CLK/DT pin states
+  g_rotaryEncoder.begin();
+
   // Set interrupts for CLK and DT
   attachInterrupt(digitalPinToInterrupt(CLK_PIN), ISR_rotaryEncoder, CHANGE);
   attachInterrupt(digitalPinToInterrupt(DT_PIN), ISR_rotaryEncoder, CHANGE);
@@ -0,0 +1,184 @@
+/**
+ * Host stand-in for the Arduino core
+ *
+ * Description:
+ * Minimal replacement of the Arduino core, so the headers of the library can
+ * be compiled with the host programs in this directory on a PC (g++ or
+ * clang++). Time is simulated: millis() and micros() return a clock, which
+ * the host program advances with hostAdvanceMicros(), so results do not depend
+ * on the speed of the PC. Pins are an array of levels, which the program sets
+ * with hostSetPin() to feed inputs and reads with hostGetPin() to check outputs.
+ * Inputs, which depend on outputs, can be modelled with hostSetReadCallback(),
+ * pulses on outputs can be recorded with hostSetWriteCallback().
+ * cli() and sei() do nothing, because the host programs call the ISR code
+ * directly from the same thread.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file arduino.h
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define bit(b) (1UL << (b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+/** Number of simulated pins */
+#define HOSTPINS 64
+
+// Simulated time in microseconds (64 bit, millis() and micros() overrun like on an Arduino)
+inline uint64_t &hostClock()
+{
+  static uint64_t s_micros = 0;
+  return s_micros;
+}
+
+/**@brief
+ * Advances the simulated time
+ *
+ * @param[in] us Microseconds
+ */
+inline void hostAdvanceMicros(unsigned long us)
+{
+  hostClock() += us;
+}
+
+inline unsigned long micros()
+{
+  return (uint32_t) hostClock();
+}
+
+inline unsigned long millis()
+{
+  return (uint32_t) (hostClock() / 1000);
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+  hostAdvanceMicros(us);
+}
+
+inline void delay(unsigned long ms)
+{
+  hostAdvanceMicros(ms * 1000);
+}
+
+// Pin levels, all pins are high after start (like inputs with pull up resistors)
+inline byte *hostPins()
+{
+  static struct pins {
+    byte level[HOSTPINS];
+    pins() { memset(level, HIGH, sizeof(level)); }
+  } s_pins;
+  return s_pins.level;
+}
+
+/**@brief
+ * Sets the level of a simulated pin, for example to feed CLK/DT
+ *
+ * @param[in] pin Pin 0..HOSTPINS-1
+ * @param[in] level HIGH or LOW
+ */
+inline void hostSetPin(uint8_t pin, uint8_t level)
+{
+  if (pin < HOSTPINS) hostPins()[pin] = level ? HIGH : LOW;
+}
+
+/**@brief
+ * Get the level of a simulated pin, for example written by digitalWrite()
+ *
+ * @param[in] pin Pin 0..HOSTPINS-1
+ *
+ * @returns HIGH or LOW
+ */
+inline uint8_t hostGetPin(uint8_t pin)
+{
+  return (pin < HOSTPINS) ? hostPins()[pin] : LOW;
+}
+
+// Optional model for input pins, which depend on other pins (for example a diode matrix)
+typedef int (*hostReadFunction)(uint8_t pin);
+inline hostReadFunction &hostReadCallback()
+{
+  static hostReadFunction s_callback = NULL;
+  return s_callback;
+}
+
+/**@brief
+ * Sets a function, which returns the level for digitalRead() instead of the pin array (NULL = pin array)
+ *
+ * @param[in] callback Function with the pin as parameter, which returns HIGH or LOW
+ */
+inline void hostSetReadCallback(hostReadFunction callback)
+{
+  hostReadCallback() = callback;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+  if (hostReadCallback() != NULL) return hostReadCallback()(pin);
+  return hostGetPin(pin);
+}
+
+// Optional recorder for written pins (for example a latch pulse)
+typedef void (*hostWriteFunction)(uint8_t pin, uint8_t level);
+inline hostWriteFunction &hostWriteCallback()
+{
+  static hostWriteFunction s_callback = NULL;
+  return s_callback;
+}
+
+/**@brief
+ * Sets a function, which is called by digitalWrite() after the level was stored in the pin array (NULL = no function)
+ *
+ * @param[in] callback Function with the pin and the level (HIGH or LOW) as parameters
+ */
+inline void hostSetWriteCallback(hostWriteFunction callback)
+{
+  hostWriteCallback() = callback;
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+  hostSetPin(pin, level);
+  if (hostWriteCallback() != NULL) hostWriteCallback()(pin, level ? HIGH : LOW);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void) pin;
+  (void) mode;
+}
+
+inline void cli() {}
+inline void sei() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/** Output base class like Print of the Arduino core (only the byte interface) */
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+      for (size_t i=0;i<size;i++) write(buffer[i]);
+      return size;
+    }
+};
@@ -0,0 +1,83 @@
+/*
+ * Host benchmark of the maximum likelihood decoder KY040Batch
+ *
+ * Creates synthetic sample traces of a random walk, 70% clockwise steps.
+ * Each state of a step is held for 6..12 samples, and the rotary encoder
+ * idles for 0..19 samples between steps. Each sample has a single bit error
+ * with a given probability. For each noise level, the program compares the
+ * true net position with KY040Batch and with checkRotation(). It also
+ * measures the KY040Batch throughput in samples/s (wall clock, single core).
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/batchBenchmark.cpp -o batchBenchmark && ./batchBenchmark
+ */
+
+#include <KY040.h>
+#include <KY040Batch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#define STEPS 20000
+#define REPEATS 20 // Decoder runs for the throughput measurement
+
+const byte c_stateOfPhase[4] = {0b11,0b01,0b00,0b10};
+
+// Sample with a single bit error with the probability noise
+byte noisy(byte state, double noise)
+{
+  if (rand() < noise * RAND_MAX) state ^= 1 << (rand() % 2);
+  return state;
+}
+
+void run(double noise)
+{
+  srand(3);
+  std::vector<byte> samples;
+  long truePosition = 0;
+  int phase = 0;
+  for (int i=0;i<STEPS;i++) {
+    int direction = (rand() % 10 < 7) ? 1 : -1;
+    for (byte j=0;j<4;j++) {
+      phase = (phase + direction) & 3;
+      int hold = 6 + rand() % 7;
+      for (int k=0;k<hold;k++) samples.push_back(noisy(c_stateOfPhase[phase], noise));
+    }
+    truePosition += direction;
+    int idle = rand() % 20;
+    for (int k=0;k<idle;k++) samples.push_back(noisy(c_stateOfPhase[0], noise));
+  }
+
+  const KY040BatchModel c_model = { 4, 12, 6, 14 };
+  std::vector<byte> work(samples.size());
+  std::vector<KY040BatchEvent> events(KY040BATCHMAXEVENTS(samples.size()));
+
+  KY040Batch batch(c_model);
+  batch.decode(samples.data(), samples.size(), work.data(), events.data(), events.size());
+
+  KY040 online(0, 1);
+  for (size_t i=0;i<samples.size();i++) {
+    online.setState(samples[i]);
+    online.checkRotation();
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i=0;i<REPEATS;i++) {
+    KY040Batch timed(c_model);
+    timed.decode(samples.data(), samples.size(), work.data(), events.data(), events.size());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%5.0f%% %9zu %9ld %9ld %15d %12.1f\n", noise * 100, samples.size(), truePosition, batch.getPosition(),
+    online.getPosition(), REPEATS * samples.size() / seconds / 1e6);
+}
+
+int main()
+{
+  printf("noise   samples      true     batch checkRotation() M samples/s\n");
+  run(0);
+  run(0.05);
+  run(0.10);
+  return 0;
+}
@@ -0,0 +1,282 @@
+/**
+ * Host model of the ESP32 pulse counter (legacy PCNT driver)
+ *
+ * Description:
+ * Replacement of driver/pcnt.h of ESP-IDF 4.x for the host programs. It models
+ * the registers of the PCNT units, which KY040PCNT uses:
+ * - two channels per unit with a pulse and a control pin, the count mode for
+ *   rising/falling pulse edges and the control mode for a low/high control pin
+ * - edges of both pins of a unit in the same update see the old level of the
+ *   other pin (like simultaneous edges in hardware)
+ * - the glitch filter in APB clock cycles (80 MHz): a level must be stable
+ *   for the filter time, shorter pulses are ignored
+ * - the h/l limit events: the counter restarts with 0 and the ISR handler is
+ *   called
+ * Call hostPcntUpdate() after each change of the simulated pins or time.
+ *
+ * The file also has stand-ins for the ESP32 core parts, which KY040PCNT uses
+ * (esp_err_t, IRAM_ATTR and the portMUX critical sections).
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file pcnt.h
+ */
+#pragma once
+
+#include <arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define IRAM_ATTR
+
+// The host programs are single threaded, so the critical sections only count the nesting
+typedef struct {
+  int nesting;
+} portMUX_TYPE;
+#define portMUX_INITIALIZE(mux) ((mux)->nesting = 0)
+#define portENTER_CRITICAL(mux) ((mux)->nesting++)
+#define portEXIT_CRITICAL(mux) ((mux)->nesting--)
+#define portENTER_CRITICAL_ISR(mux) ((mux)->nesting++)
+#define portEXIT_CRITICAL_ISR(mux) ((mux)->nesting--)
+
+typedef enum { PCNT_UNIT_0, PCNT_UNIT_1, PCNT_UNIT_2, PCNT_UNIT_3, PCNT_UNIT_MAX } pcnt_unit_t;
+typedef enum { PCNT_CHANNEL_0, PCNT_CHANNEL_1, PCNT_CHANNEL_MAX } pcnt_channel_t;
+typedef enum { PCNT_COUNT_DIS, PCNT_COUNT_INC, PCNT_COUNT_DEC } pcnt_count_mode_t;
+typedef enum { PCNT_MODE_KEEP, PCNT_MODE_REVERSE, PCNT_MODE_DISABLE } pcnt_ctrl_mode_t;
+typedef enum { PCNT_EVT_L_LIM = 1, PCNT_EVT_H_LIM = 2 } pcnt_evt_type_t;
+
+typedef struct {
+  int pulse_gpio_num;
+  int ctrl_gpio_num;
+  pcnt_ctrl_mode_t lctrl_mode;
+  pcnt_ctrl_mode_t hctrl_mode;
+  pcnt_count_mode_t pos_mode;
+  pcnt_count_mode_t neg_mode;
+  int16_t counter_h_lim;
+  int16_t counter_l_lim;
+  pcnt_unit_t unit;
+  pcnt_channel_t channel;
+} pcnt_config_t;
+
+typedef void (*pcntHandler)(void *arg);
+
+// Filtered input pin of a unit
+struct pcntInput {
+  int pin; // -1 = unused
+  byte level; // Level after the glitch filter
+  byte pending; // Raw level, which waits for the filter time
+  uint64_t pendingSince;
+};
+
+// Registers of a unit
+struct pcntUnit {
+  bool configured[PCNT_CHANNEL_MAX];
+  pcnt_config_t channels[PCNT_CHANNEL_MAX];
+  pcntInput inputs[2]; // Pins of the unit
+  int16_t counter;
+  int16_t highLimit;
+  int16_t lowLimit;
+  uint16_t filterValue;
+  bool filterEnabled;
+  bool paused;
+  uint32_t enabledEvents;
+  uint32_t status; // Events of the last limit
+  pcntHandler handler;
+  void *handlerArg;
+};
+
+struct pcntModel {
+  pcntUnit units[PCNT_UNIT_MAX];
+  bool serviceInstalled;
+  unsigned long interrupts; // Number of ISR handler calls
+};
+
+inline pcntModel &hostPcnt()
+{
+  static pcntModel s_model = {};
+  return s_model;
+}
+
+// Finds or adds a pin of the unit
+inline pcntInput *hostPcntInput(pcntUnit &unit, int pin)
+{
+  for (byte i=0;i<2;i++) if (unit.inputs[i].pin == pin) return &unit.inputs[i];
+  for (byte i=0;i<2;i++) {
+    if (unit.inputs[i].pin == -1) {
+      unit.inputs[i].pin = pin;
+      unit.inputs[i].level = unit.inputs[i].pending = hostGetPin(pin);
+      unit.inputs[i].pendingSince = hostClock();
+      return &unit.inputs[i];
+    }
+  }
+  return NULL;
+}
+
+inline esp_err_t pcnt_unit_config(const pcnt_config_t *config)
+{
+  if ((config == NULL) || (config->unit >= PCNT_UNIT_MAX) || (config->channel >= PCNT_CHANNEL_MAX)) return ESP_ERR_INVALID_ARG;
+  pcntUnit &unit = hostPcnt().units[config->unit];
+  bool used = unit.configured[PCNT_CHANNEL_0] || unit.configured[PCNT_CHANNEL_1];
+  if (!used) {
+    for (byte i=0;i<2;i++) unit.inputs[i].pin = -1;
+    unit.paused = false;
+  }
+  if ((hostPcntInput(unit, config->pulse_gpio_num) == NULL) || (hostPcntInput(unit, config->ctrl_gpio_num) == NULL)) return ESP_ERR_INVALID_ARG;
+  unit.channels[config->channel] = *config;
+  unit.configured[config->channel] = true;
+  unit.highLimit = config->counter_h_lim;
+  unit.lowLimit = config->counter_l_lim;
+  unit.counter = 0;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t filterValue)
+{
+  if ((unit >= PCNT_UNIT_MAX) || (filterValue > 1023)) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].filterValue = filterValue;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_filter_enable(pcnt_unit_t unit)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].filterEnabled = true;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_filter_disable(pcnt_unit_t unit)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].filterEnabled = false;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_event_enable(pcnt_unit_t unit, pcnt_evt_type_t event)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].enabledEvents |= event;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_isr_service_install(int flags)
+{
+  (void) flags;
+  if (hostPcnt().serviceInstalled) return ESP_ERR_INVALID_STATE;
+  hostPcnt().serviceInstalled = true;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_isr_handler_add(pcnt_unit_t unit, pcntHandler handler, void *arg)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  if (!hostPcnt().serviceInstalled) return ESP_ERR_INVALID_STATE;
+  hostPcnt().units[unit].handler = handler;
+  hostPcnt().units[unit].handlerArg = arg;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_pause(pcnt_unit_t unit)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].paused = true;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_resume(pcnt_unit_t unit)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].paused = false;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_clear(pcnt_unit_t unit)
+{
+  if (unit >= PCNT_UNIT_MAX) return ESP_ERR_INVALID_ARG;
+  hostPcnt().units[unit].counter = 0;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t *count)
+{
+  if ((unit >= PCNT_UNIT_MAX) || (count == NULL)) return ESP_ERR_INVALID_ARG;
+  *count = hostPcnt().units[unit].counter;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_get_event_status(pcnt_unit_t unit, uint32_t *status)
+{
+  if ((unit >= PCNT_UNIT_MAX) || (status == NULL)) return ESP_ERR_INVALID_ARG;
+  *status = hostPcnt().units[unit].status;
+  return ESP_OK;
+}
+
+// Counts an edge of the pulse pin of a channel with the level of the control pin
+inline void hostPcntCount(pcntUnit &unit, const pcnt_config_t &channel, bool rising, byte ctrlLevel)
+{
+  pcnt_count_mode_t countMode = rising ? channel.pos_mode : channel.neg_mode;
+  pcnt_ctrl_mode_t ctrlMode = (ctrlLevel == LOW) ? channel.lctrl_mode : channel.hctrl_mode;
+  if ((countMode == PCNT_COUNT_DIS) || (ctrlMode == PCNT_MODE_DISABLE)) return;
+  int delta = (countMode == PCNT_COUNT_INC) ? 1 : -1;
+  if (ctrlMode == PCNT_MODE_REVERSE) delta = -delta;
+  unit.counter += delta;
+
+  uint32_t event = 0;
+  if (unit.counter >= unit.highLimit) event = PCNT_EVT_H_LIM;
+  if (unit.counter <= unit.lowLimit) event = PCNT_EVT_L_LIM;
+  if (event == 0) return;
+  unit.counter = 0; // Restarts at a limit
+  unit.status = event;
+  if ((unit.enabledEvents & event) && (unit.handler != NULL)) {
+    hostPcnt().interrupts++;
+    unit.handler(unit.handlerArg);
+  }
+}
+
+/**@brief
+ * Applies the filtered pin changes since the last call to the counters. Call it after each change of the simulated pins or time.
+ */
+inline void hostPcntUpdate()
+{
+  for (byte u=0;u<PCNT_UNIT_MAX;u++) {
+    pcntUnit &unit = hostPcnt().units[u];
+    if (!unit.configured[PCNT_CHANNEL_0] && !unit.configured[PCNT_CHANNEL_1]) continue;
+    // Levels after the glitch filter
+    byte oldLevels[2];
+    bool changed[2];
+    for (byte i=0;i<2;i++) {
+      pcntInput &input = unit.inputs[i];
+      oldLevels[i] = input.level;
+      changed[i] = false;
+      if (input.pin == -1) continue;
+      byte raw = hostGetPin(input.pin);
+      if (raw != input.pending) {
+        input.pending = raw;
+        input.pendingSince = hostClock();
+      }
+      if (input.pending == input.level) continue;
+      // The filter ignores pulses shorter than filterValue APB clock cycles (80 MHz)
+      if (unit.filterEnabled && ((hostClock() - input.pendingSince) * 80 < unit.filterValue)) continue;
+      input.level = input.pending;
+      changed[i] = true;
+    }
+    if (unit.paused) continue;
+    // Each channel sees the old level of the other pin
+    for (byte c=0;c<PCNT_CHANNEL_MAX;c++) {
+      if (!unit.configured[c]) continue;
+      const pcnt_config_t &channel = unit.channels[c];
+      for (byte i=0;i<2;i++) {
+        if (!changed[i] || (unit.inputs[i].pin != channel.pulse_gpio_num)) continue;
+        byte ctrlLevel = (unit.inputs[0].pin == channel.ctrl_gpio_num) ? oldLevels[0] : oldLevels[1];
+        hostPcntCount(unit, channel, unit.inputs[i].level == HIGH, ctrlLevel);
+      }
+    }
+  }
+}
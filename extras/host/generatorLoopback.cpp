@@ -0,0 +1,82 @@
+/*
+ * Host loopback test of KY040Generator and KY040
+ *
+ * Like the quadratureGenerator example without hardware: tick() runs in a
+ * simulated 10 kHz timer ISR and writes the CLK/DT pins. When a pin has
+ * changed, the states go through setState()/checkRotation() like in a pin
+ * change ISR. The generator follows 200 random targets (-100..100) with a
+ * maximum of 200 steps/s. For each number of bounces (on 50% of the edges),
+ * the program reports:
+ * - moves, where the decoded position did not reach the target
+ * - the configured and the measured step rate (fastest time between two
+ *   decoded steps)
+ * - rejected CLK/DT states of the decoder
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/generatorLoopback.cpp -o generatorLoopback && ./generatorLoopback
+ */
+
+#include <KY040Generator.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CLK_PIN 6
+#define DT_PIN 7
+#define TICKMICROS 100 // Timer period
+#define MAXSTEPRATE 200
+#define MOVES 200
+#define BOUNCEPERCENT 50
+
+// Returns true, when all moves reached their target and the step rate was not exceeded
+bool run(byte bounces)
+{
+  KY040Generator generator(CLK_PIN, DT_PIN, TICKMICROS);
+  KY040 decoder(CLK_PIN, DT_PIN);
+  generator.begin();
+  decoder.begin();
+  generator.setMaxStepRate(MAXSTEPRATE);
+  generator.setBounce(bounces, BOUNCEPERCENT);
+
+  srand(bounces);
+  unsigned int errors = 0;
+  unsigned long steps = 0;
+  unsigned long minStepMicros = 0xFFFFFFFF;
+  byte lastState = (hostGetPin(CLK_PIN) << 1) | hostGetPin(DT_PIN);
+  for (int move=0;move<MOVES;move++) {
+    int target = rand() % 201 - 100;
+    generator.setTarget(target);
+    unsigned long lastStepMicros = 0;
+    bool moving = false;
+    while (!generator.isIdle()) {
+      hostAdvanceMicros(TICKMICROS);
+      generator.tick(); // Timer ISR
+      byte state = (hostGetPin(CLK_PIN) << 1) | hostGetPin(DT_PIN);
+      if (state == lastState) continue;
+      lastState = state;
+      decoder.setState(state); // Pin change ISR
+      byte result = decoder.checkRotation();
+      if ((result != KY040::CLOCKWISE) && (result != KY040::COUNTERCLOCKWISE)) continue;
+      steps++;
+      if (moving && (micros() - lastStepMicros < minStepMicros)) minStepMicros = micros() - lastStepMicros;
+      lastStepMicros = micros();
+      moving = true;
+    }
+    if (decoder.getPosition() != target) errors++;
+  }
+
+  double measuredRate = (minStepMicros == 0xFFFFFFFF) ? 0 : 1e6 / minStepMicros;
+  bool ok = (errors == 0) && (measuredRate <= MAXSTEPRATE);
+  printf("%7u %6d %6u %8lu %10lu %10.1f %9u   %s\n", bounces, MOVES, errors, steps, generator.getStepRate(),
+    measuredRate, decoder.getRejectedCount(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  printf("%d us timer, max. %d steps/s, bounces on %d%% of the edges\n\n", TICKMICROS, MAXSTEPRATE, BOUNCEPERCENT);
+  printf("bounces  moves errors    steps   rate_set rate_max    rejected\n");
+  printf("                                (steps/s) (measured)  states\n");
+  bool ok = true;
+  for (byte bounces=0;bounces<=3;bounces++) ok &= run(bounces);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/*
+ * Host test of KY040Journal with a file backed block device
+ *
+ * The block device writes 512 byte blocks into a temporary file. It can fail
+ * the next write (the journal retries it) or tear the next write like a power
+ * loss (only the first bytes reach the file). The program writes steps,
+ * restarts the journal with a new object on the same file, replays all valid
+ * blocks in the order of their sequence numbers and checks:
+ * - steps, positions and timestamps after a failed write
+ * - dropped steps, when update() is not called
+ * - recovery after a torn block (the torn block is ignored, the journal
+ *   continues after the last complete block)
+ * - a full block is written by update() without the timeout
+ * - the ring of blocks keeps the newest blocks
+ * - 0 blocks are used as one block
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/journalTest.cpp -o journalTest && ./journalTest
+ */
+
+#include <KY040Journal.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+#define DEVICEBLOCKS 40
+#define FIRSTBLOCK 2 // Journal does not start at block 0
+#define TEARBYTES 200 // Bytes of a torn write
+
+// Block device on a temporary file
+class fileDevice {
+  public:
+    fileDevice()
+    {
+      m_file = tmpfile();
+      m_failNext = false;
+      m_tearNext = false;
+      byte zero[KY040JOURNALBLOCKSIZE] = {};
+      for (unsigned long i=0;i<DEVICEBLOCKS;i++) writeBlock(i, zero);
+    }
+
+    ~fileDevice()
+    {
+      if (m_file != NULL) fclose(m_file);
+    }
+
+    bool readBlock(unsigned long block, byte *data)
+    {
+      if ((m_file == NULL) || (block >= DEVICEBLOCKS)) return false;
+      fseek(m_file, block * KY040JOURNALBLOCKSIZE, SEEK_SET);
+      return fread(data, 1, KY040JOURNALBLOCKSIZE, m_file) == KY040JOURNALBLOCKSIZE;
+    }
+
+    bool writeBlock(unsigned long block, const byte *data)
+    {
+      if ((m_file == NULL) || (block >= DEVICEBLOCKS)) return false;
+      if (m_failNext) {
+        m_failNext = false;
+        return false;
+      }
+      size_t size = m_tearNext ? TEARBYTES : KY040JOURNALBLOCKSIZE;
+      m_tearNext = false;
+      fseek(m_file, block * KY040JOURNALBLOCKSIZE, SEEK_SET);
+      bool result = fwrite(data, 1, size, m_file) == size;
+      fflush(m_file);
+      return result;
+    }
+
+    // The next write fails
+    void failNext()
+    {
+      m_failNext = true;
+    }
+
+    // Only the first bytes of the next write reach the file (power loss)
+    void tearNext()
+    {
+      m_tearNext = true;
+    }
+  private:
+    FILE *m_file;
+    bool m_failNext;
+    bool m_tearNext;
+};
+
+typedef KY040Journal<fileDevice> fileJournal;
+
+unsigned int g_failed = 0;
+int g_position = 0;
+
+void check(const char *name, long value, long expected)
+{
+  bool ok = (value == expected);
+  if (!ok) g_failed++;
+  printf("%-58s %8ld %8ld   %s\n", name, value, expected, ok ? "ok" : "FAILED");
+}
+
+// Adds clockwise steps, one each 10 ms, optionally with update() after each step
+void addSteps(fileJournal &journal, int count, bool update)
+{
+  for (int i=0;i<count;i++) {
+    hostAdvanceMicros(10000);
+    g_position++;
+    journal.add(i % 3, g_position, KY040::CLOCKWISE);
+    if (update) journal.update();
+  }
+}
+
+// Writes the remaining steps after the flush timeout
+void flush(fileJournal &journal)
+{
+  hostAdvanceMicros(2000000);
+  for (byte i=0;i<2;i++) while (!journal.update()); // Both buffers, write errors are retried
+}
+
+// Reads the valid blocks of the journal ordered by sequence number
+std::vector<KY040JournalStep> replay(fileDevice &device, unsigned long blocks)
+{
+  std::vector<std::pair<unsigned long, std::vector<KY040JournalStep> > > found;
+  byte block[KY040JOURNALBLOCKSIZE];
+  KY040JournalStep steps[KY040JOURNALSTEPS];
+  for (unsigned long i=0;i<blocks;i++) {
+    if (!device.readBlock(FIRSTBLOCK + i, block)) continue;
+    unsigned long sequence;
+    unsigned int count = fileJournal::getSteps(block, steps, sequence);
+    if (count > 0) found.push_back(std::make_pair(sequence, std::vector<KY040JournalStep>(steps, steps + count)));
+  }
+  std::sort(found.begin(), found.end(),
+    [](const std::pair<unsigned long, std::vector<KY040JournalStep> > &a, const std::pair<unsigned long, std::vector<KY040JournalStep> > &b) { return a.first < b.first; });
+  std::vector<KY040JournalStep> result;
+  for (size_t i=0;i<found.size();i++) result.insert(result.end(), found[i].second.begin(), found[i].second.end());
+  return result;
+}
+
+// Number of steps, which do not continue the position of the previous step or go back in time
+long countGaps(const std::vector<KY040JournalStep> &steps)
+{
+  long gaps = 0;
+  for (size_t i=1;i<steps.size();i++) {
+    if ((steps[i].position != steps[i-1].position + 1) || (steps[i].millis < steps[i-1].millis)) gaps++;
+  }
+  return gaps;
+}
+
+int main()
+{
+  printf("%-58s %8s %8s\n", "check", "value", "expected");
+  fileDevice device;
+  {
+    fileJournal journal(device, FIRSTBLOCK, 16, 1000);
+    check("begin() on an empty device", journal.begin(), true);
+    check("begin() on an empty device: sequence", journal.getSequence(), 0);
+
+    // 200 steps, the write of the second block fails once
+    addSteps(journal, 100, true);
+    device.failNext();
+    addSteps(journal, 100, true);
+    flush(journal);
+    check("200 steps: write errors", journal.getWriteErrorCount(), 1);
+    check("200 steps: written blocks (3 full, 1 by timeout)", journal.getWrittenBlockCount(), 4);
+    std::vector<KY040JournalStep> steps = replay(device, 16);
+    check("200 steps: replayed steps", steps.size(), 200);
+    check("200 steps: replayed gaps", countGaps(steps), 0);
+    check("200 steps: last replayed position", steps.empty() ? 0 : steps.back().position, g_position);
+    check("200 steps: first replayed timestamp (ms)", steps.empty() ? 0 : steps.front().millis, 10);
+
+    // Without update() only the double buffer is filled
+    addSteps(journal, 3 * KY040JOURNALSTEPS, false);
+    check("no update(): dropped steps", journal.getDroppedCount(), KY040JOURNALSTEPS);
+    flush(journal);
+    steps = replay(device, 16);
+    check("no update(): replayed steps", steps.size(), 200 + 2 * KY040JOURNALSTEPS);
+
+    // Power loss while writing a block
+    addSteps(journal, KY040JOURNALSTEPS + 8, false);
+    device.tearNext();
+    journal.update();
+  }
+  {
+    fileJournal journal(device, FIRSTBLOCK, 16, 1000);
+    check("restart after torn block: begin()", journal.begin(), true);
+    check("restart after torn block: next sequence", journal.getSequence(), 6);
+    std::vector<KY040JournalStep> steps = replay(device, 16);
+    check("restart after torn block: replayed steps", steps.size(), 200 + 2 * KY040JOURNALSTEPS);
+    check("restart after torn block: replayed gaps", countGaps(steps), 0);
+
+    // The journal continues in the torn block
+    g_position = steps.back().position;
+    addSteps(journal, 10, true);
+    flush(journal);
+    steps = replay(device, 16);
+    check("continued after restart: replayed steps", steps.size(), 200 + 2 * KY040JOURNALSTEPS + 10);
+    check("continued after restart: replayed gaps", countGaps(steps), 0);
+  }
+  {
+    // Ring of 4 blocks, 10 full blocks are written
+    fileDevice ringDevice;
+    fileJournal journal(ringDevice, FIRSTBLOCK, 4, 1000);
+    journal.begin();
+    g_position = 0;
+    addSteps(journal, 10 * KY040JOURNALSTEPS, true);
+    check("ring of 4 blocks: written blocks without timeout", journal.getWrittenBlockCount(), 10);
+    fileJournal restarted(ringDevice, FIRSTBLOCK, 4, 1000);
+    restarted.begin();
+    check("ring of 4 blocks: next sequence after restart", restarted.getSequence(), 10);
+    std::vector<KY040JournalStep> steps = replay(ringDevice, 4);
+    check("ring of 4 blocks: replayed steps (newest 4 blocks)", steps.size(), 4 * KY040JOURNALSTEPS);
+    check("ring of 4 blocks: replayed gaps", countGaps(steps), 0);
+    check("ring of 4 blocks: last replayed position", steps.empty() ? 0 : steps.back().position, g_position);
+  }
+
+  {
+    // Zero blocks are used as one block
+    fileDevice oneDevice;
+    fileJournal journal(oneDevice, FIRSTBLOCK, 0, 1000);
+    check("0 blocks: begin()", journal.begin(), true);
+    g_position = 0;
+    addSteps(journal, KY040JOURNALSTEPS + 1, true);
+    check("0 blocks: written blocks", journal.getWrittenBlockCount(), 1);
+    std::vector<KY040JournalStep> steps = replay(oneDevice, 1);
+    check("0 blocks: replayed steps", steps.size(), KY040JOURNALSTEPS);
+  }
+
+  printf("\n%s (%u failed)\n", (g_failed == 0) ? "All checks passed" : "CHECKS FAILED", g_failed);
+  return (g_failed == 0) ? 0 : 1;
+}
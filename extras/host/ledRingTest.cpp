@@ -0,0 +1,155 @@
+/*
+ * Host test of KY040LedRing with a recording bus
+ *
+ * The bus records the transferred bytes and the latch pin is recorded with
+ * hostSetWriteCallback(), so the test sees the bytes of each latched chain
+ * like the 74HC595 outputs. Two rings with 16 LEDs on a chain of four bytes
+ * are checked:
+ * - DOT, BAR and WRAP patterns
+ * - WRAP for negative positions
+ * - clamping of DOT and BAR at the minimum and maximum position
+ * - the chain is only shifted out, when a pattern has changed, and then as a
+ *   whole with one latch pulse
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/ledRingTest.cpp -o ledRingTest && ./ledRingTest
+ */
+
+#include <KY040LedRing.h>
+#include <stdio.h>
+#include <vector>
+
+#define LATCH_PIN 10
+#define RINGS 2
+#define LEDS 16
+#define CHAINBYTES (RINGS * LEDS / 8)
+
+// Bus with a byte transfer(byte) method like SPIClass, which records the bytes
+class recordingBus {
+  public:
+    byte transfer(byte value)
+    {
+      pending.push_back(value);
+      return 0;
+    }
+
+    std::vector<byte> pending; // Bytes since the last latch pulse
+};
+
+typedef KY040LedRing<recordingBus, RINGS, LEDS> ledRing;
+
+recordingBus g_bus;
+std::vector<byte> g_latched; // Bytes of the last latch pulse in transfer order
+unsigned long g_latchCount = 0;
+unsigned int g_failed = 0;
+
+// Latches the shifted bytes on the rising edge of the latch pin
+void latchWritten(uint8_t pin, uint8_t level)
+{
+  if ((pin != LATCH_PIN) || (level != HIGH)) return;
+  g_latched = g_bus.pending;
+  g_bus.pending.clear();
+  g_latchCount++;
+}
+
+// LEDs of a ring from the last latched chain (bit 0 = first LED). The last transferred byte stays in the first 74HC595.
+long getLeds(byte ring)
+{
+  if (g_latched.size() != CHAINBYTES) return -1;
+  long result = 0;
+  for (byte i=0;i<LEDS/8;i++) result |= (long) g_latched[CHAINBYTES - 1 - (ring * (LEDS / 8) + i)] << (8*i);
+  return result;
+}
+
+void check(const char *name, long value, long expected)
+{
+  bool ok = (value == expected);
+  if (!ok) g_failed++;
+  printf("%-58s %8ld %8ld   %s\n", name, value, expected, ok ? "ok" : "FAILED");
+}
+
+int main()
+{
+  hostSetWriteCallback(latchWritten);
+  KY040 encoderX(2, 3);
+  KY040 encoderY(4, 5);
+  ledRing rings(g_bus, LATCH_PIN);
+  printf("%-58s %8s %8s\n", "check", "value", "expected");
+
+  rings.attach(0, encoderX, ledRing::DOT, 0, 100);
+  rings.attach(1, encoderY, ledRing::WRAP);
+  rings.begin();
+  check("begin(): latch pulses", g_latchCount, 1);
+  check("begin(): latched bytes", g_latched.size(), CHAINBYTES);
+  check("begin(): latch pin after the pulse", hostGetPin(LATCH_PIN), LOW);
+  check("DOT at 0 (0..100): LEDs", getLeds(0), 0x0001);
+  check("DOT at 0 (0..100): in the first 74HC595 after the MCU", g_latched.back(), 0x01);
+  check("WRAP at 0: LEDs", getLeds(1), 0x0001);
+
+  // Only changed patterns are shifted out
+  check("update() without a change", rings.update(), false);
+  check("update() without a change: latch pulses", g_latchCount, 1);
+  encoderX.setPosition(50);
+  check("DOT at 50: update()", rings.update(), true);
+  check("DOT at 50: LEDs (50*15/100 = LED 7)", getLeds(0), 0x0080);
+  check("DOT at 50: WRAP ring unchanged", getLeds(1), 0x0001);
+  check("DOT at 50: whole chain latched", g_latched.size(), CHAINBYTES);
+  encoderX.setPosition(51);
+  check("DOT at 51 (same LED): update()", rings.update(), false);
+  check("DOT at 51 (same LED): shifted bytes", g_bus.pending.size(), 0);
+  encoderX.setPosition(100);
+  rings.update();
+  check("DOT at 100: LEDs", getLeds(0), 0x8000);
+
+  // Clamping at the minimum and maximum
+  encoderX.setPosition(-20);
+  rings.update();
+  check("DOT at -20 (clamped to 0): LEDs", getLeds(0), 0x0001);
+  encoderX.setPosition(200);
+  rings.update();
+  check("DOT at 200 (clamped to 100): LEDs", getLeds(0), 0x8000);
+
+  // Bar
+  rings.attach(0, encoderX, ledRing::BAR, 0, 100);
+  encoderX.setPosition(50);
+  rings.update();
+  check("BAR at 50: LEDs", getLeds(0), 0x00FF);
+  encoderX.setPosition(100);
+  rings.update();
+  check("BAR at 100: LEDs", getLeds(0), 0xFFFF);
+  encoderX.setPosition(1000);
+  check("BAR at 1000 (clamped to 100): update()", rings.update(), false);
+  encoderX.setPosition(-5);
+  rings.update();
+  check("BAR at -5 (clamped to 0): LEDs", getLeds(0), 0x0001);
+  rings.attach(0, encoderX, ledRing::BAR, -10, 5);
+  encoderX.setPosition(-10);
+  rings.update();
+  check("BAR at -10 (-10..5): LEDs", getLeds(0), 0x0001);
+  encoderX.setPosition(5);
+  rings.update();
+  check("BAR at 5 (-10..5): LEDs", getLeds(0), 0xFFFF);
+
+  // Wrap
+  encoderY.setPosition(17);
+  rings.update();
+  check("WRAP at 17: LEDs", getLeds(1), 0x0002);
+  encoderY.setPosition(-1);
+  rings.update();
+  check("WRAP at -1: LEDs", getLeds(1), 0x8000);
+  encoderY.setPosition(-16);
+  rings.update();
+  check("WRAP at -16: LEDs", getLeds(1), 0x0001);
+  encoderY.setPosition(-17);
+  rings.update();
+  check("WRAP at -17: LEDs", getLeds(1), 0x8000);
+  encoderY.setPosition(-33);
+  check("WRAP at -33 (same LED): update()", rings.update(), false);
+  check("WRAP at -17: BAR ring unchanged", getLeds(0), 0xFFFF);
+
+  check("transfer count = latch pulses", rings.getTransferCount(), g_latchCount);
+  check("no bytes without a latch pulse", g_bus.pending.size(), 0);
+
+  printf("\n%s (%u failed)\n", (g_failed == 0) ? "All checks passed" : "CHECKS FAILED", g_failed);
+  return (g_failed == 0) ? 0 : 1;
+}
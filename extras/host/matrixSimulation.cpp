@@ -0,0 +1,193 @@
+/*
+ * Host simulation of KY040Matrix
+ *
+ * Simulates a diode matrix of 4 groups with 4 rotary encoders each. The
+ * return lines read LOW when the contact of the rotary encoder in the
+ * selected group (strobe LOW) is closed. The line model has a settle time:
+ * for a while after a strobe switch, the lines still show the previous
+ * group. Contacts bounce after each edge. The rotary encoders turn at the
+ * same rate, neighbour groups in opposite directions, and reverse their
+ * direction every 1.3 s at a detent.
+ *
+ * For each timer rate, settle time and turn rate, the program compares the
+ * decoded positions with the true positions. It also reports the host time
+ * per scan() (wall clock), as a relative decode cost.
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/matrixSimulation.cpp -o matrixSimulation && ./matrixSimulation
+ */
+
+#include <KY040Matrix.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+
+#define GROUPS 4
+#define ENCODERSPERGROUP 4
+#define ENCODERS (GROUPS * ENCODERSPERGROUP)
+#define SIMULATIONMICROS 4000000UL // 4 s
+#define RESOLUTIONMICROS 5 // Time resolution of the contact model
+#define BOUNCEMICROS 300 // Bounce time after each edge
+#define REVERSEMICROS 1300000UL // Time between two direction changes
+
+const byte c_strobePins[GROUPS] = { 40, 41, 42, 43 };
+const byte c_clkPins[ENCODERSPERGROUP] = { 2, 4, 6, 8 };
+const byte c_dtPins[ENCODERSPERGROUP] = { 3, 5, 7, 9 };
+const byte c_stateOfPhase[4] = { 0b11, 0b01, 0b00, 0b10 }; // Clockwise order
+
+// Contacts of a rotary encoder turned at a constant rate
+struct contactModel {
+  int position; // True position
+  unsigned long steps; // Number of turned steps
+  byte phase;
+  int direction;
+  uint64_t edgeMicros; // Time between two edges
+  uint64_t nextEdge;
+  uint64_t nextReverse;
+  uint64_t bounceUntil;
+  byte bounceMask; // Contact of the last edge
+  byte state; // CLK/DT contacts (0 = closed)
+};
+
+contactModel g_contacts[ENCODERS];
+byte g_previousGroup = 0;
+uint64_t g_switchMicros = 0; // Time of the last strobe switch
+unsigned int g_lineSettleMicros = 0;
+
+// Updates the contacts until the current time
+void updateContacts()
+{
+  for (byte i=0;i<ENCODERS;i++) {
+    contactModel &contact = g_contacts[i];
+    while (contact.nextEdge <= hostClock()) {
+      if ((contact.phase == 0) && (contact.nextEdge >= contact.nextReverse)) { // Reverse at a detent
+        contact.direction = -contact.direction;
+        contact.nextReverse += REVERSEMICROS;
+      }
+      byte oldState = c_stateOfPhase[contact.phase];
+      contact.phase = (contact.phase + contact.direction) & 3;
+      if (contact.phase == 0) {
+        contact.position += contact.direction;
+        contact.steps++;
+      }
+      contact.bounceMask = oldState ^ c_stateOfPhase[contact.phase];
+      contact.bounceUntil = contact.nextEdge + BOUNCEMICROS;
+      contact.nextEdge += contact.edgeMicros;
+    }
+    contact.state = c_stateOfPhase[contact.phase];
+    if ((hostClock() < contact.bounceUntil) && (rand() & 1)) contact.state ^= contact.bounceMask;
+  }
+}
+
+// Level of a return line: LOW, when the contact of the selected group is closed (the diode conducts)
+int readReturnLine(uint8_t pin)
+{
+  byte group = 0;
+  for (byte i=0;i<GROUPS;i++) if (hostGetPin(c_strobePins[i]) == LOW) group = i;
+  if (hostClock() - g_switchMicros < g_lineSettleMicros) group = g_previousGroup; // Lines have not settled
+  for (byte i=0;i<ENCODERSPERGROUP;i++) {
+    byte state = g_contacts[group * ENCODERSPERGROUP + i].state;
+    if (pin == c_clkPins[i]) return (state & 0b10) ? HIGH : LOW;
+    if (pin == c_dtPins[i]) return (state & 0b01) ? HIGH : LOW;
+  }
+  return HIGH; // Pull up
+}
+
+void run(unsigned long timerHz, unsigned int settleMicros, unsigned int lineSettleMicros, unsigned int stepsPerSecond)
+{
+  srand(1);
+  uint64_t begin = hostClock();
+  for (byte i=0;i<ENCODERS;i++) {
+    contactModel &contact = g_contacts[i];
+    contact.position = 0;
+    contact.steps = 0;
+    contact.phase = 0;
+    contact.direction = ((i / ENCODERSPERGROUP) & 1) ? -1 : 1; // Neighbour groups turn in opposite directions
+    contact.edgeMicros = 1000000UL / (4UL * stepsPerSecond);
+    contact.nextEdge = begin + 1000 + i * 37; // Encoders are not in phase
+    contact.nextReverse = begin + REVERSEMICROS;
+    contact.bounceUntil = 0;
+    contact.bounceMask = 0;
+    contact.state = c_stateOfPhase[0];
+  }
+  g_lineSettleMicros = lineSettleMicros;
+
+  KY040 *encoders = (KY040 *) malloc(ENCODERS * sizeof(KY040)); // No default constructor for an array
+  for (byte i=0;i<ENCODERS;i++) new (&encoders[i]) KY040(c_clkPins[i % ENCODERSPERGROUP], c_dtPins[i % ENCODERSPERGROUP]);
+  KY040Matrix matrix(c_strobePins, GROUPS, c_clkPins, c_dtPins, ENCODERSPERGROUP, encoders, settleMicros);
+  matrix.begin();
+  g_previousGroup = 0;
+  g_switchMicros = hostClock();
+
+  uint64_t tickMicros = 1000000UL / timerHz;
+  uint64_t nextTick = begin + tickMicros;
+  unsigned long scans = 0;
+  double scanSeconds = 0;
+  while (hostClock() - begin < SIMULATIONMICROS) {
+    hostAdvanceMicros(RESOLUTIONMICROS);
+    updateContacts();
+    if (hostClock() >= nextTick) { // Timer ISR
+      nextTick += tickMicros;
+      byte group = scans % GROUPS;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      matrix.scan();
+      scanSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      scans++;
+      g_previousGroup = group;
+      g_switchMicros = hostClock();
+    }
+  }
+  // Stop turning at a detent and let the matrix catch up
+  for (byte i=0;i<ENCODERS;i++) {
+    while (g_contacts[i].phase != 0) {
+      hostAdvanceMicros(g_contacts[i].nextEdge - hostClock());
+      updateContacts();
+    }
+    g_contacts[i].nextEdge = (uint64_t) -1;
+  }
+  hostAdvanceMicros(BOUNCEMICROS);
+  updateContacts();
+  for (unsigned long i=0;i<4*GROUPS;i++) {
+    byte group = scans % GROUPS;
+    matrix.scan();
+    scans++;
+    g_previousGroup = group;
+    g_switchMicros = hostClock();
+    hostAdvanceMicros(tickMicros);
+  }
+
+  long steps = 0;
+  long missed = 0;
+  unsigned int rejected = 0;
+  for (byte i=0;i<ENCODERS;i++) {
+    steps += g_contacts[i].steps;
+    long difference = g_contacts[i].position - encoders[i].getPosition();
+    missed += (difference < 0) ? -difference : difference;
+    rejected += encoders[i].getRejectedCount();
+    encoders[i].~KY040();
+  }
+  free(encoders);
+  printf("%7lu %8lu %9u %11u %8u %9ld %9ld %9u %10.0f\n", timerHz, timerHz / GROUPS, settleMicros, lineSettleMicros,
+    stepsPerSecond, steps, missed, rejected, scanSeconds * 1e9 / scans);
+}
+
+int main()
+{
+  hostSetReadCallback(readReturnLine);
+  printf("%d groups x %d rotary encoders, %lu s, %d us bounce after each edge\n\n", GROUPS, ENCODERSPERGROUP, SIMULATIONMICROS / 1000000UL, BOUNCEMICROS);
+  printf("timer_Hz group_Hz settle_us line_settle steps/s    steps  position  rejected ns/scan\n");
+  printf("                                  _us  (each)  (total)     error    states   (host)\n");
+  // Turn rate at the default 4 kHz timer (1 kHz for each group)
+  const unsigned int c_rates[] = { 10, 50, 100, 200, 300 };
+  for (byte i=0;i<sizeof(c_rates)/sizeof(c_rates[0]);i++) run(4000, 0, 20, c_rates[i]);
+  printf("\n");
+  // Faster timer for faster rotations
+  run(8000, 0, 20, 200);
+  run(8000, 0, 20, 300);
+  printf("\n");
+  // Slow return lines (for example long cables), fixed by the settle time
+  run(4000, 0, 300, 50);
+  run(4000, 300, 300, 50);
+  return 0;
+}
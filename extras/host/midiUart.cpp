@@ -0,0 +1,217 @@
+/*
+ * Host measurement of KY040Midi on a UART stand-in
+ *
+ * Eight rotary encoders are spun at a constant rate. Their CLK/DT sequences
+ * go through setState()/checkRotation() like in a pin change ISR, and
+ * KY040Midi::update() runs in a simulated loop. The UART stand-in sends 10
+ * bits per byte at 31250 baud, 320 us per byte. Like HardwareSerial on an
+ * Arduino Uno, it has a 64 byte send buffer, and write() blocks the loop while
+ * the buffer is full. The stand-in also decodes the sent bytes like a MIDI
+ * receiver, including running status. When the last byte of a Control Change
+ * has been sent, the latency of each step in it is recorded.
+ *
+ * For each interval and spin rate, the program reports:
+ * - messages/s and bytes/s
+ * - link usage
+ * - time the loop was blocked by the full send buffer
+ * - step to receiver latency (median, 99th percentile, max)
+ * - the receiver position check
+ * The naive output, one 3 byte message per step, is shown for comparison.
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/midiUart.cpp -o midiUart && ./midiUart
+ */
+
+#include <KY040Midi.h>
+#include <stdio.h>
+
+#define ENCODERS 8
+#define BYTEMICROS 320 // 10 bits at 31250 baud
+#define SENDBUFFER 64 // Send buffer of HardwareSerial
+#define LOOPMICROS 100 // Period of the simulated loop
+#define SIMULATIONMICROS 10000000UL // 10 s
+#define MAXSTEPS 4096 // Steps waiting for the receiver per encoder
+
+// MIDI output with 31250 baud timing and a receiver, which measures the latency of each step
+class UartStandIn : public Print {
+  public:
+    UartStandIn()
+    {
+      m_busyUntil = 0;
+      m_queued = 0;
+      m_blockedMicros = 0;
+      m_status = 0;
+      m_dataCount = 0;
+      m_maxLatency = 0;
+      for (byte i=0;i<ENCODERS;i++) {
+        m_received[i] = 0;
+        m_stepHead[i] = m_stepTail[i] = 0;
+      }
+    }
+
+    // Called for each finished step of an encoder
+    void addStep(byte index)
+    {
+      m_stepTimes[index][m_stepTail[index] % MAXSTEPS] = hostClock();
+      m_stepTail[index]++;
+    }
+
+    size_t write(uint8_t value)
+    {
+      drain();
+      if (m_queued >= SENDBUFFER) { // Buffer full, the loop waits until one byte was sent
+        uint64_t wait = m_sendTimes[0] - hostClock();
+        hostAdvanceMicros(wait);
+        m_blockedMicros += wait;
+        drain();
+      }
+      uint64_t start = (m_busyUntil > hostClock()) ? m_busyUntil : hostClock();
+      m_busyUntil = start + BYTEMICROS;
+      m_sendTimes[m_queued] = m_busyUntil;
+      m_bytes[m_queued] = value;
+      m_queued++;
+      return 1;
+    }
+
+    // Receives all bytes, which are sent until now
+    void drain()
+    {
+      byte sent = 0;
+      while ((sent < m_queued) && (m_sendTimes[sent] <= hostClock())) {
+        receive(m_bytes[sent], m_sendTimes[sent]);
+        sent++;
+      }
+      for (byte i=sent;i<m_queued;i++) {
+        m_sendTimes[i-sent] = m_sendTimes[i];
+        m_bytes[i-sent] = m_bytes[i];
+      }
+      m_queued -= sent;
+    }
+
+    int getReceivedPosition(byte index)
+    {
+      return m_received[index];
+    }
+
+    uint64_t getBlockedMicros()
+    {
+      return m_blockedMicros;
+    }
+
+    KY040Histogram &getLatencyHistogram()
+    {
+      return m_latency;
+    }
+
+    uint64_t getMaxLatency()
+    {
+      return m_maxLatency;
+    }
+  private:
+    // MIDI receiver with running status (controller 16 is the first encoder)
+    void receive(byte value, uint64_t time)
+    {
+      if (value & 0x80) {
+        m_status = value;
+        m_dataCount = 0;
+        return;
+      }
+      m_data[m_dataCount++] = value;
+      if (m_dataCount < 2) return;
+      m_dataCount = 0;
+      byte index = m_data[0] - 16;
+      if (((m_status & 0xF0) != 0xB0) || (index >= ENCODERS)) return;
+      int delta = (m_data[1] & 0x40) ? (int) m_data[1] - 128 : m_data[1]; // Two's complement
+      m_received[index] += delta;
+      for (int i=0;i<((delta < 0) ? -delta : delta);i++) {
+        if (m_stepHead[index] == m_stepTail[index]) break;
+        uint64_t latency = time - m_stepTimes[index][m_stepHead[index] % MAXSTEPS];
+        m_stepHead[index]++;
+        m_latency.record(latency);
+        if (latency > m_maxLatency) m_maxLatency = latency;
+      }
+    }
+
+    uint64_t m_busyUntil; // End of the last queued byte
+    uint64_t m_sendTimes[SENDBUFFER]; // End of each queued byte
+    byte m_bytes[SENDBUFFER];
+    byte m_queued;
+    uint64_t m_blockedMicros;
+    byte m_status;
+    byte m_data[2];
+    byte m_dataCount;
+    int m_received[ENCODERS];
+    uint64_t m_stepTimes[ENCODERS][MAXSTEPS];
+    unsigned long m_stepHead[ENCODERS];
+    unsigned long m_stepTail[ENCODERS];
+    KY040Histogram m_latency;
+    uint64_t m_maxLatency;
+};
+
+const byte c_sequenceCW[4] = {0b01,0b00,0b10,0b11};
+
+// Runs one configuration and prints a result line
+void run(unsigned int intervalMillis, unsigned int stepsPerSecond)
+{
+  UartStandIn &uart = *new UartStandIn(); // Large step buffers, not on the stack
+  KY040 *encoders[ENCODERS];
+  for (byte i=0;i<ENCODERS;i++) encoders[i] = new KY040(2*i, 2*i+1);
+  KY040Midi midi(uart, KY040Midi::TWOSCOMPLEMENT, intervalMillis);
+  for (byte i=0;i<ENCODERS;i++) midi.attach(*encoders[i], 0, 16 + i);
+
+  uint64_t begin = hostClock();
+  uint64_t stepMicros = 1000000UL / stepsPerSecond;
+  uint64_t nextStep[ENCODERS];
+  for (byte i=0;i<ENCODERS;i++) nextStep[i] = begin + i * stepMicros / ENCODERS; // Encoders are not in phase
+  while (hostClock() - begin < SIMULATIONMICROS) {
+    for (byte i=0;i<ENCODERS;i++) {
+      while (nextStep[i] <= hostClock()) { // Step sequence as seen by the pin change ISR
+        for (byte j=0;j<4;j++) {
+          encoders[i]->setState(c_sequenceCW[j]);
+          if (encoders[i]->checkRotation() == KY040::CLOCKWISE) uart.addStep(i);
+        }
+        nextStep[i] += stepMicros;
+      }
+    }
+    midi.update();
+    uart.drain();
+    hostAdvanceMicros(LOOPMICROS);
+  }
+  // Stop spinning and send the remaining steps
+  for (int i=0;i<2000;i++) {
+    midi.update();
+    uart.drain();
+    hostAdvanceMicros(LOOPMICROS);
+  }
+
+  bool complete = true;
+  for (byte i=0;i<ENCODERS;i++) {
+    if (uart.getReceivedPosition(i) != encoders[i]->getPosition()) complete = false;
+    delete encoders[i];
+  }
+  double seconds = SIMULATIONMICROS / 1e6;
+  KY040Histogram &latency = uart.getLatencyHistogram();
+  printf("%8u %10u %8.0f %8.0f %5.0f%% %9.0f %8lu %8lu %8lu   %s\n",
+    intervalMillis, stepsPerSecond,
+    midi.getMessageCount() / seconds, midi.getByteCount() / seconds,
+    100.0 * midi.getByteCount() * BYTEMICROS / SIMULATIONMICROS,
+    uart.getBlockedMicros() / 1000.0,
+    latency.getPercentile(50), latency.getPercentile(99), (unsigned long) uart.getMaxLatency(),
+    complete ? "ok" : "MISMATCH");
+  delete &uart;
+}
+
+int main()
+{
+  printf("%d encoders, 31250 baud (max. %d bytes/s), %lu s each\n\n", ENCODERS, 1000000 / BYTEMICROS, SIMULATIONMICROS / 1000000UL);
+  printf("interval steps/s   msgs/s  bytes/s  link blocked_ms  lat_p50  lat_p99  lat_max   receiver\n");
+  printf("    (ms) (each enc)                                     (us, rounded up to 2^n-1)\n");
+  const unsigned int c_rates[] = {20, 100, 300};
+  const unsigned int c_intervals[] = {0, 5, 10, 20};
+  for (byte r=0;r<sizeof(c_rates)/sizeof(c_rates[0]);r++) {
+    for (byte i=0;i<sizeof(c_intervals)/sizeof(c_intervals[0]);i++) run(c_intervals[i], c_rates[r]);
+    printf("   naive %10u %8u %8u %5.0f%%\n", c_rates[r], ENCODERS * c_rates[r], 3 * ENCODERS * c_rates[r],
+      100.0 * 3 * ENCODERS * c_rates[r] * BYTEMICROS / 1e6);
+  }
+  return 0;
+}
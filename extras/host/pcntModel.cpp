@@ -0,0 +1,147 @@
+/*
+ * Host test of KY040PCNT on a model of the ESP32 pulse counter
+ *
+ * driver/pcnt.h in this directory models the PCNT registers (channel rules,
+ * glitch filter, limit events with the ISR handler). The program feeds CLK/DT
+ * sequences with bounces to two rotary encoders, one with the default glitch
+ * filter (1023 APB cycles = 12.8 us) and one without a filter, and checks:
+ * - +4 counts per clockwise step and -4 counts per counter-clockwise step
+ * - no phantom steps for bounces at a detent and half steps
+ * - the accumulation of the counter limit events
+ * - the realignment of the anchor after a skipped state
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -DESP32 -Iextras/host -Isrc extras/host/pcntModel.cpp -o pcntModel && ./pcntModel
+ */
+
+#include <KY040PCNT.h>
+#include <stdio.h>
+
+#define HOLDMICROS 200 // Time of each state of a step
+#define FILTERED_CLK_PIN 32
+#define FILTERED_DT_PIN 33
+#define UNFILTERED_CLK_PIN 25
+#define UNFILTERED_DT_PIN 26
+
+const byte c_sequenceCW[4] = {0b01,0b00,0b10,0b11};
+const byte c_sequenceCCW[4] = {0b10,0b00,0b01,0b11};
+
+unsigned int g_failed = 0;
+
+// Advances the simulated time in steps of 1 us for the glitch filter
+void wait(unsigned long us)
+{
+  for (unsigned long i=0;i<us;i++) {
+    hostAdvanceMicros(1);
+    hostPcntUpdate();
+  }
+}
+
+// Sets the CLK/DT pins of a rotary encoder (Left bit is for CLK, right bit is for DT)
+void setState(byte pinCLK, byte pinDT, byte state, unsigned long holdMicros)
+{
+  hostSetPin(pinCLK, (state & 0b10) ? HIGH : LOW);
+  hostSetPin(pinDT, (state & 0b01) ? HIGH : LOW);
+  hostPcntUpdate();
+  wait(holdMicros);
+}
+
+// Turns a rotary encoder, each edge bounces bounceCount times with pulses of bounceMicros
+void turn(byte pinCLK, byte pinDT, int steps, byte bounceCount = 0, unsigned long bounceMicros = 0)
+{
+  const byte *sequence = (steps >= 0) ? c_sequenceCW : c_sequenceCCW;
+  byte state = 0b11;
+  for (long i=0;i<((steps >= 0) ? steps : -steps);i++) {
+    for (byte j=0;j<4;j++) {
+      for (byte k=0;k<bounceCount;k++) {
+        setState(pinCLK, pinDT, sequence[j], bounceMicros);
+        setState(pinCLK, pinDT, state, bounceMicros);
+      }
+      state = sequence[j];
+      setState(pinCLK, pinDT, state, HOLDMICROS);
+    }
+  }
+}
+
+void check(const char *name, long value, long expected)
+{
+  bool ok = (value == expected);
+  if (!ok) g_failed++;
+  printf("%-58s %8ld %8ld   %s\n", name, value, expected, ok ? "ok" : "FAILED");
+}
+
+int main()
+{
+  KY040PCNT filtered(FILTERED_CLK_PIN, FILTERED_DT_PIN, PCNT_UNIT_0);
+  KY040PCNT unfiltered(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, PCNT_UNIT_1, 0);
+  printf("%-58s %8s %8s\n", "check", "value", "expected");
+  check("begin() filtered", filtered.begin(), true);
+  check("begin() unfiltered (ISR service already installed)", unfiltered.begin(), true);
+
+  // Counting directions
+  turn(FILTERED_CLK_PIN, FILTERED_DT_PIN, 10);
+  check("10 clockwise steps: count", filtered.getCount(), 40);
+  check("10 clockwise steps: position", filtered.getPosition(), 10);
+  turn(FILTERED_CLK_PIN, FILTERED_DT_PIN, -10);
+  check("10 counter-clockwise steps: count", filtered.getCount(), 0);
+  check("10 counter-clockwise steps: position", filtered.getPosition(), 0);
+
+  // Bounces shorter than the glitch filter do not reach the counter
+  for (byte i=0;i<20;i++) {
+    setState(FILTERED_CLK_PIN, FILTERED_DT_PIN, 0b01, 3);
+    setState(FILTERED_CLK_PIN, FILTERED_DT_PIN, 0b11, 3);
+  }
+  wait(HOLDMICROS);
+  check("3 us bounces at the detent (filter): count", filtered.getCount(), 0);
+  turn(FILTERED_CLK_PIN, FILTERED_DT_PIN, 5, 3, 3);
+  check("5 steps with 3 us bounces (filter): count", filtered.getCount(), 20);
+  check("5 steps with 3 us bounces (filter): position", filtered.getPosition(), 5);
+
+  // Without filter the bounces are counted, but cancel out at the next idle state
+  long phantomSteps = 0;
+  for (byte i=0;i<20;i++) {
+    setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b01, 20);
+    if (unfiltered.getPosition() != 0) phantomSteps++;
+    setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b11, 20);
+    if (unfiltered.getPosition() != 0) phantomSteps++;
+  }
+  check("20 us bounces at the detent (no filter): phantom steps", phantomSteps, 0);
+  check("20 us bounces at the detent (no filter): count", unfiltered.getCount(), 0);
+  check("20 us bounces at the detent (no filter): position", unfiltered.getPosition(), 0);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b01, HOLDMICROS);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b00, HOLDMICROS);
+  check("half step (no filter): position", unfiltered.getPosition(), 0);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b01, HOLDMICROS);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b11, HOLDMICROS);
+  check("half step and back (no filter): count", unfiltered.getCount(), 0);
+  check("half step and back (no filter): position", unfiltered.getPosition(), 0);
+  turn(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, -7, 3, 20);
+  check("7 ccw steps with 20 us bounces (no filter): count", unfiltered.getCount(), -28);
+  check("7 ccw steps with 20 us bounces (no filter): position", unfiltered.getPosition(), -7);
+
+  // Counter limit events
+  unsigned long interrupts = hostPcnt().interrupts;
+  turn(FILTERED_CLK_PIN, FILTERED_DT_PIN, 9000);
+  check("9000 clockwise steps: limit interrupts", hostPcnt().interrupts - interrupts, 1);
+  check("9000 clockwise steps: count", filtered.getCount(), 36020);
+  check("9000 clockwise steps: position", filtered.getPosition(), 9005);
+  turn(FILTERED_CLK_PIN, FILTERED_DT_PIN, -18000);
+  check("18000 counter-clockwise steps: limit interrupts", hostPcnt().interrupts - interrupts, 3);
+  check("18000 counter-clockwise steps: count", filtered.getCount(), -35980);
+  check("18000 counter-clockwise steps: position", filtered.getPosition(), -8995);
+
+  // Skipped state: both pins change in the same sample (01 -> 10) and the counter moves by 2 instead of 4
+  unsigned long realigned = unfiltered.getRealignedCount();
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b01, HOLDMICROS);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b10, HOLDMICROS);
+  setState(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 0b11, HOLDMICROS);
+  check("skipped state: count", unfiltered.getCount(), -26);
+  check("skipped state: position", unfiltered.getPosition(), -7);
+  check("skipped state: realigned anchors", unfiltered.getRealignedCount() - realigned, 1);
+  turn(UNFILTERED_CLK_PIN, UNFILTERED_DT_PIN, 5);
+  check("5 clockwise steps after realignment: position", unfiltered.getPosition(), -2);
+  check("5 clockwise steps after realignment: realigned anchors", unfiltered.getRealignedCount() - realigned, 1);
+
+  printf("\n%s (%u failed)\n", (g_failed == 0) ? "All checks passed" : "CHECKS FAILED", g_failed);
+  return (g_failed == 0) ? 0 : 1;
+}
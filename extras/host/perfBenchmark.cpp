@@ -0,0 +1,230 @@
+/*
+ * Host benchmark of the decoders with hardware performance counters
+ *
+ * Runs checkRotation() (with setState() for each sample like in an ISR) and
+ * KY040Batch on synthetic clean and bouncy traces, like the decoderBenchmark
+ * example, and reports per sample:
+ * - CPU cycles and instructions (IPC)
+ * - branches and branch misses
+ * - cache misses
+ * - wall time in nanoseconds
+ *
+ * The counters are read with perf_event_open() (Linux, user space only). When
+ * a counter is not available (other OS, container/VM without a PMU or
+ * kernel.perf_event_paranoid > 2), it is shown as n/a and only the wall time
+ * is measured.
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -Iextras/host -Isrc extras/host/perfBenchmark.cpp -o perfBenchmark && ./perfBenchmark
+ */
+
+#include <KY040.h>
+#include <KY040Batch.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+#include <chrono>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define TRACESIZE 1000000 // Samples of each trace
+#define REPEATS 20 // Runs of each measurement, the fastest run is shown
+
+// Hardware counters
+enum counters {
+  CYCLES,
+  INSTRUCTIONS,
+  BRANCHES,
+  BRANCHMISSES,
+  CACHEMISSES,
+  COUNTERS
+};
+
+const char *c_counterNames[COUNTERS] = { "cycles", "instructions", "branches", "branch-misses", "cache-misses" };
+
+// Counters of the process in user space (file descriptor -1 = not available)
+class perfCounters {
+  public:
+    perfCounters()
+    {
+      #if defined(__linux__)
+      const unsigned long long c_configs[COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+      };
+      for (byte i=0;i<COUNTERS;i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = c_configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        m_errors[i] = (m_fds[i] == -1) ? errno : 0;
+      }
+      #else
+      for (byte i=0;i<COUNTERS;i++) {
+        m_fds[i] = -1;
+        m_errors[i] = ENOSYS;
+      }
+      #endif
+    }
+
+    ~perfCounters()
+    {
+      #if defined(__linux__)
+      for (byte i=0;i<COUNTERS;i++) if (m_fds[i] != -1) close(m_fds[i]);
+      #endif
+    }
+
+    bool available(byte counter)
+    {
+      return m_fds[counter] != -1;
+    }
+
+    int getError(byte counter)
+    {
+      return m_errors[counter];
+    }
+
+    void start()
+    {
+      #if defined(__linux__)
+      for (byte i=0;i<COUNTERS;i++) {
+        if (m_fds[i] == -1) continue;
+        ioctl(m_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+      }
+      #endif
+    }
+
+    // Stops counting and stores the values (0 for counters, which are not available)
+    void stop(unsigned long long values[COUNTERS])
+    {
+      for (byte i=0;i<COUNTERS;i++) {
+        values[i] = 0;
+        #if defined(__linux__)
+        if (m_fds[i] == -1) continue;
+        ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) values[i] = 0;
+        #endif
+      }
+    }
+  private:
+    int m_fds[COUNTERS];
+    int m_errors[COUNTERS];
+};
+
+perfCounters g_counters;
+std::vector<byte> g_trace;
+std::vector<byte> g_work;
+std::vector<KY040BatchEvent> g_events;
+volatile long g_sink; // Keeps the results, so the compiler cannot remove the decoding
+
+// Creates a trace of clockwise and counter-clockwise steps, each transition with bounces
+void createTrace(byte bounces)
+{
+  const byte c_sequenceCW[] = { 0b01, 0b00, 0b10, 0b11 };
+  g_trace.clear();
+  byte state = INITSTEP;
+  bool clockwise = true;
+  while (g_trace.size() + 4*(2*bounces+1) <= TRACESIZE) {
+    for (byte i=0;i<4;i++) {
+      byte next = clockwise ? c_sequenceCW[i] : c_sequenceCW[(6-i)%4];
+      for (byte j=0;j<bounces;j++) { // Bounce between the old and the new state
+        g_trace.push_back(next);
+        g_trace.push_back(state);
+      }
+      g_trace.push_back(next);
+      state = next;
+    }
+    clockwise = !clockwise;
+  }
+  g_work.resize(g_trace.size());
+  g_events.resize(KY040BATCHMAXEVENTS(g_trace.size()));
+}
+
+void runCheckRotation()
+{
+  KY040 rotaryEncoder(2,3);
+  long sum = 0;
+  for (size_t i=0;i<g_trace.size();i++) {
+    rotaryEncoder.setState(g_trace[i]);
+    sum += rotaryEncoder.checkRotation();
+  }
+  g_sink = sum + rotaryEncoder.getPosition();
+}
+
+void runBatch()
+{
+  const KY040BatchModel c_model = { 4, 12, 6, 14 };
+  KY040Batch decoder(c_model);
+  g_sink = decoder.decode(g_trace.data(), g_trace.size(), g_work.data(), g_events.data(), g_events.size()) + decoder.getPosition();
+}
+
+// Prints a value for each sample or n/a
+void printPerSample(byte counter, unsigned long long value, const char *format)
+{
+  if (g_counters.available(counter)) printf(format, (double) value / g_trace.size()); else printf("%9s", "n/a");
+}
+
+// Measures a decoder and prints the counters of the fastest run
+void measure(const char *decoder, const char *trace, void (*run)())
+{
+  unsigned long long best[COUNTERS];
+  double bestSeconds = 0;
+  run(); // Warm up
+  for (byte r=0;r<REPEATS;r++) {
+    unsigned long long values[COUNTERS];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    g_counters.start();
+    run();
+    g_counters.stop(values);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if ((r == 0) || (seconds < bestSeconds)) {
+      bestSeconds = seconds;
+      for (byte i=0;i<COUNTERS;i++) best[i] = values[i];
+    }
+  }
+
+  printf("%-16s %-7s", decoder, trace);
+  printPerSample(CYCLES, best[CYCLES], "%9.2f");
+  printPerSample(INSTRUCTIONS, best[INSTRUCTIONS], "%9.2f");
+  if (g_counters.available(CYCLES) && g_counters.available(INSTRUCTIONS) && (best[CYCLES] > 0)) {
+    printf("%6.2f", (double) best[INSTRUCTIONS] / best[CYCLES]);
+  } else printf("%6s", "n/a");
+  printPerSample(BRANCHES, best[BRANCHES], "%9.2f");
+  printPerSample(BRANCHMISSES, best[BRANCHMISSES], "%9.4f");
+  printPerSample(CACHEMISSES, best[CACHEMISSES], "%9.4f");
+  printf("%9.2f\n", bestSeconds * 1e9 / g_trace.size());
+}
+
+int main()
+{
+  bool missing = false;
+  for (byte i=0;i<COUNTERS;i++) {
+    if (g_counters.available(i)) continue;
+    printf("Counter %s is not available: %s\n", c_counterNames[i], strerror(g_counters.getError(i)));
+    missing = true;
+  }
+  if (missing) printf("(perf_event_open() needs Linux, a PMU in the VM/container and kernel.perf_event_paranoid <= 2)\n\n");
+
+  printf("Per sample, fastest of %d runs with %d samples\n", REPEATS, TRACESIZE);
+  printf("decoder          trace     cycles    instr   IPC branches b-misses c-misses  wall_ns\n");
+  const byte c_bounces[] = { 0, 2 };
+  const char *c_traceNames[] = { "clean", "bouncy" };
+  for (byte i=0;i<2;i++) {
+    createTrace(c_bounces[i]);
+    measure("checkRotation()", c_traceNames[i], runCheckRotation);
+    measure("KY040Batch", c_traceNames[i], runBatch);
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Host simulation of KY040SyncEncoder and KY040SyncDecoder
+ *
+ * 16 rotary encoders, a frame each 50 ms and a keyframe each second. Every
+ * 2 s one or two other knobs are turned at about 10 steps/s, 2/3 of the
+ * steps clockwise. Frames and acknowledges get lost with a given probability.
+ * After each frame the program compares the mirrored positions of the
+ * decoder with the positions of the rotary encoders.
+ *
+ * For each loss rate, the program reports:
+ * - bytes/s of the delta compressed frames
+ * - bytes/s of full state keyframes for comparison
+ * - lost and rejected frames
+ * - frame periods with a stale mirror and the longest time until recovery
+ *
+ * Build and run (from the repository root):
+ *   g++ -O2 -DARDUINO -Iextras/host -Isrc extras/host/syncSimulation.cpp -o syncSimulation && ./syncSimulation
+ */
+
+#include <KY040Sync.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#define ENCODERS 16
+#define SIMULATIONMILLIS 600000UL // 10 min
+#define FRAMEMILLIS 50
+#define KEYFRAMEMILLIS 1000
+#define STEPMILLIS 100 // Turn rate of the first knob
+#define KNOBMILLIS 2000 // Time until other knobs are turned
+
+void run(unsigned int lossPercent)
+{
+  srand(1);
+  KY040 *encoders = (KY040 *) malloc(ENCODERS * sizeof(KY040)); // No default constructor for an array
+  KY040 *pointers[ENCODERS];
+  for (byte i=0;i<ENCODERS;i++) {
+    new (&encoders[i]) KY040(2*i, 2*i+1);
+    pointers[i] = &encoders[i];
+  }
+  KY040SyncEncoder<ENCODERS> sender(pointers, KEYFRAMEMILLIS, 200);
+  KY040SyncDecoder<ENCODERS> receiver;
+  byte frame[KY040SYNCMAXFRAMESIZE(ENCODERS)];
+
+  unsigned long lost = 0;
+  unsigned long keyframeBytes = 0;
+  unsigned long staleFrames = 0;
+  unsigned long staleRun = 0;
+  unsigned long maxStaleRun = 0;
+  byte first = 0;
+  byte second = 1;
+  uint64_t begin = hostClock();
+  for (unsigned long ms=0;ms<SIMULATIONMILLIS;ms++) {
+    if (ms % KNOBMILLIS == 0) {
+      first = rand() % ENCODERS;
+      second = rand() % ENCODERS;
+    }
+    if (ms % STEPMILLIS == 0) {
+      encoders[first].setPosition(encoders[first].getPosition() + ((rand() % 3) ? 1 : -1));
+      // Every second period a second knob at half the rate
+      if ((ms % (2*STEPMILLIS) == 0) && ((ms / KNOBMILLIS) & 1)) encoders[second].setPosition(encoders[second].getPosition() + 1);
+    }
+    if (ms % FRAMEMILLIS == 0) {
+      size_t size = sender.encode(frame);
+      if ((size > 0) && (frame[0] == KY040SYNCKEYFRAME)) keyframeBytes += size;
+      if ((size > 0) && ((unsigned int) (rand() % 100) < lossPercent)) lost++;
+      else if ((size > 0) && receiver.decode(frame, size)) {
+        if ((unsigned int) (rand() % 100) >= lossPercent) sender.acknowledge(receiver.getSequence());
+      }
+      bool stale = false;
+      for (byte i=0;i<ENCODERS;i++) if (receiver.getPosition(i) != encoders[i].getPosition()) stale = true;
+      if (stale) {
+        staleFrames++;
+        staleRun++;
+        if (staleRun > maxStaleRun) maxStaleRun = staleRun;
+      } else staleRun = 0;
+    }
+    hostAdvanceMicros(1000);
+  }
+
+  double seconds = (hostClock() - begin) / 1e6;
+  printf("%4u%% %8.1f %9.1f %8.1f %7.1f %8lu %9lu %8lu %9lu\n", lossPercent, sender.getByteCount() / seconds,
+    (double) keyframeBytes / sender.getKeyframeCount() * (1000 / FRAMEMILLIS), sender.getFrameCount() / seconds,
+    sender.getKeyframeCount() / seconds, lost, receiver.getRejectedCount(), staleFrames, maxStaleRun * FRAMEMILLIS);
+
+  for (byte i=0;i<ENCODERS;i++) encoders[i].~KY040();
+  free(encoders);
+}
+
+int main()
+{
+  printf("%d encoders, frame each %d ms, keyframe each %d ms, %lu s each\n\n", ENCODERS, FRAMEMILLIS, KEYFRAMEMILLIS, SIMULATIONMILLIS / 1000);
+  printf(" loss  bytes/s  full_B/s frames/s  keys/s     lost  rejected    stale max_stale\n");
+  printf("               (only keyframes)                                periods      (ms)\n");
+  run(0);
+  run(5);
+  run(20);
+  return 0;
+}
@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""
+Static worst case execution time (WCET) of an AVR ISR, for example the
+pin change ISR calling KY040::checkRotation().
+
+Measured cycle counts only cover the paths a test happens to hit. This tool
+reads the disassembly of the compiled sketch (avr-objdump -d), builds the
+control flow graph of the ISR and all called functions and reports the
+longest path in CPU cycles (ATmega328P instruction timings).
+
+Usage:
+  ky040_wcet.py sketch.elf --function __vector_5 --budget 500 [--isr] [--wakeup 16384]
+  ky040_wcet.py sketch.lst --function __vector_5 --loop-bound 0x8a4=4
+
+  Inputs: ELF files (disassembled with avr-objdump) or text files with the
+          output of avr-objdump -d. Give one input for each configuration.
+  --function       Symbol of the ISR, for example __vector_5 for PCINT2_vect
+  --budget         Exit with 1, when the WCET of an input exceeds this number of cycles
+  --isr            Add the worst case interrupt response (4+4+3 cycles): response,
+                   instruction in progress (call, ret or reti) and vector table jump
+  --wakeup         CYCLES, start-up time of the sleep mode (see the datasheet and
+                   the SUT/CKSEL fuses), adds it and 4 response cycles for the
+                   wakeup from sleep. Use it, when the ISR wakes up the MCU.
+  --loop-bound     ADDRESS=N, maximum iterations of the loop with the header at ADDRESS
+  --default-loop-bound  N for loops without --loop-bound (otherwise loops are an error)
+  --mhz            CPU clock for the microseconds column (default 16)
+
+The WCET does not include the time, when the interrupt cannot be served:
+other ISRs, cli() sections and the instruction after reti or sei.
+
+Indirect jumps and calls (ijmp, icall, __tablejump2__) cannot be analyzed.
+Compile the sketch for the analysis with -fno-jump-tables to prevent jump
+tables for switch statements. Recursion is an error.
+
+Exit codes: 0 = all inputs within budget, 1 = budget exceeded, 2 = analysis error
+
+License: 2-Clause BSD License
+Copyright (c) 2024 codingABI
+For details see: LICENSE.txt
+
+Home: https://github.com/codingABI/KY040
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+# Cycles for ATmega328P (AVRe+, 2 byte program counter)
+CYCLES = {
+    'adiw': 2, 'sbiw': 2, 'mul': 2, 'muls': 2, 'mulsu': 2, 'fmul': 2, 'fmuls': 2, 'fmulsu': 2,
+    'ld': 2, 'ldd': 2, 'lds': 2, 'st': 2, 'std': 2, 'sts': 2, 'push': 2, 'pop': 2,
+    'sbi': 2, 'cbi': 2, 'lpm': 3, 'elpm': 3,
+    'rjmp': 2, 'jmp': 3, 'ijmp': 2, 'eijmp': 2, 'rcall': 3, 'call': 4, 'icall': 3, 'eicall': 4,
+    'ret': 4, 'reti': 4,
+}
+TWOWORDS = ('jmp', 'call', 'lds', 'sts')
+BRANCHES = ('breq', 'brne', 'brcs', 'brcc', 'brsh', 'brlo', 'brmi', 'brpl', 'brge', 'brlt',
+            'brhs', 'brhc', 'brts', 'brtc', 'brvs', 'brvc', 'brie', 'brid', 'brbs', 'brbc')
+SKIPS = ('cpse', 'sbrc', 'sbrs', 'sbic', 'sbis')
+INTERRUPTRESPONSE = 4 + 3  # Interrupt response and jmp in the vector table
+LONGESTINSTRUCTION = 4  # An instruction in progress (call, ret, reti) is finished before the interrupt is served
+SLEEPRESPONSE = 4  # Additional response cycles, when the interrupt wakes up the MCU from sleep
+
+
+class AnalysisError(Exception):
+    pass
+
+
+class Instruction:
+    def __init__(self, address, size, mnemonic, operands, target):
+        self.address = address
+        self.size = size
+        self.mnemonic = mnemonic
+        self.operands = operands
+        self.target = target  # Branch/jump/call target or None
+
+
+FUNCTIONLINE = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+INSTRUCTIONLINE = re.compile(r'^\s+([0-9a-f]+):\t((?:[0-9a-f]{2} )+)\s*\t(\S+)\s*([^;]*?)\s*(?:;\s*(.*))?$')
+COMMENTTARGET = re.compile(r'0x([0-9a-f]+)')
+
+
+def parse(text):
+    """Returns {function name: [Instruction]} and {address: function name}"""
+    functions = {}
+    names = {}
+    current = None
+    for line in text.splitlines():
+        match = FUNCTIONLINE.match(line)
+        if match:
+            current = match.group(2)
+            functions[current] = []
+            names[int(match.group(1), 16)] = current
+            continue
+        match = INSTRUCTIONLINE.match(line)
+        if not match or current is None:
+            continue
+        address = int(match.group(1), 16)
+        size = len(match.group(2).split())
+        mnemonic = match.group(3)
+        operands = match.group(4)
+        comment = match.group(5) or ''
+        target = None
+        if mnemonic in BRANCHES or mnemonic in ('rjmp', 'rcall', 'jmp', 'call'):
+            found = COMMENTTARGET.search(comment)
+            if found:
+                target = int(found.group(1), 16)
+            elif operands.startswith('.'):
+                target = address + 2 + int(operands.split(',')[-1].strip()[1:], 0)
+            else:
+                target = int(operands.split(',')[-1].strip(), 0)
+        functions[current].append(Instruction(address, size, mnemonic, operands, target))
+    return functions, names
+
+
+class Analyzer:
+    def __init__(self, functions, names, loopBounds, defaultLoopBound):
+        self.functions = functions
+        self.names = names
+        self.loopBounds = loopBounds
+        self.defaultLoopBound = defaultLoopBound
+        self.cache = {}
+        self.active = set()
+
+    def wcet(self, name):
+        """Returns (cycles, worst path as list of block addresses) of a function including its callees"""
+        if name in self.cache:
+            return self.cache[name]
+        if name in self.active:
+            raise AnalysisError('recursion in %s' % name)
+        if name not in self.functions:
+            raise AnalysisError('function %s not found' % name)
+        self.active.add(name)
+        result = self.analyze(name, self.functions[name])
+        self.active.discard(name)
+        self.cache[name] = result
+        return result
+
+    def callee(self, instruction):
+        if instruction.mnemonic in ('icall', 'eicall'):
+            raise AnalysisError('indirect call at 0x%x' % instruction.address)
+        name = self.names.get(instruction.target)
+        if name is None:
+            raise AnalysisError('call target 0x%x at 0x%x is no function' % (instruction.target, instruction.address))
+        if name.startswith('__tablejump'):
+            raise AnalysisError('jump table at 0x%x (compile with -fno-jump-tables)' % instruction.address)
+        return self.wcet(name)[0]
+
+    def analyze(self, name, code):
+        if not code:
+            raise AnalysisError('function %s is empty' % name)
+        byAddress = {instruction.address: index for index, instruction in enumerate(code)}
+        start = code[0].address
+        end = code[-1].address + 2 * code[-1].size
+
+        # Successors of each instruction: list of (index or None for exit, extra cycles of this edge)
+        def successors(index):
+            instruction = code[index]
+            mnemonic = instruction.mnemonic
+            following = index + 1 if index + 1 < len(code) else None
+            if mnemonic in ('ret', 'reti'):
+                return [(None, 0)]
+            if mnemonic in ('ijmp', 'eijmp'):
+                raise AnalysisError('indirect jump at 0x%x in %s' % (instruction.address, name))
+            if mnemonic in ('rjmp', 'jmp'):
+                if start <= instruction.target < end:
+                    return [(byAddress[instruction.target], 0)]
+                # Tail call to another function
+                target = self.names.get(instruction.target)
+                if target is None:
+                    raise AnalysisError('jump target 0x%x at 0x%x is no function' % (instruction.target, instruction.address))
+                return [(None, self.wcet(target)[0])]
+            if mnemonic in BRANCHES:
+                if instruction.target not in byAddress:
+                    raise AnalysisError('branch target 0x%x at 0x%x outside of %s' % (instruction.target, instruction.address, name))
+                return [(following, 0), (byAddress[instruction.target], 1)]
+            if mnemonic in SKIPS:
+                if following is None or following + 1 > len(code):
+                    raise AnalysisError('skip at the end of %s' % name)
+                skipped = code[following]
+                extra = 2 if skipped.mnemonic in TWOWORDS else 1
+                return [(following, 0), (following + 1 if following + 1 < len(code) else None, extra)]
+            if following is None:
+                raise AnalysisError('%s has no return at the end' % name)
+            return [(following, 0)]
+
+        def cost(index):
+            instruction = code[index]
+            if instruction.mnemonic == 'rcall' and instruction.target == instruction.address + 2:
+                return CYCLES['rcall']  # rcall .+0 only reserves stack space
+            if instruction.mnemonic in ('rcall', 'call', 'icall', 'eicall'):
+                return CYCLES[instruction.mnemonic] + self.callee(instruction)
+            return CYCLES.get(instruction.mnemonic, 1)
+
+        edges = [successors(index) for index in range(len(code))]
+        weights = [cost(index) for index in range(len(code))]
+
+        # Back edges by depth first search from the entry
+        state = [0] * len(code)  # 0 = new, 1 = on stack, 2 = done
+        backEdges = []
+        stack = [(0, iter(edges[0]))]
+        state[0] = 1
+        while stack:
+            node, iterator = stack[-1]
+            advanced = False
+            for successor, extra in iterator:
+                if successor is None:
+                    continue
+                if state[successor] == 1:
+                    backEdges.append((node, successor, extra))
+                elif state[successor] == 0:
+                    state[successor] = 1
+                    stack.append((successor, iter(edges[successor])))
+                    advanced = True
+                    break
+            if not advanced:
+                state[node] = 2
+                stack.pop()
+        backSet = set((tail, header) for tail, header, extra in backEdges)
+
+        def forward(node):
+            return [(successor, extra) for successor, extra in edges[node]
+                    if successor is None or (node, successor) not in backSet]
+
+        # Topological order of the graph without back edges
+        order = []
+        visited = [False] * len(code)
+        stack = [(0, False)]
+        while stack:
+            node, expanded = stack.pop()
+            if expanded:
+                order.append(node)
+                continue
+            if visited[node]:
+                continue
+            visited[node] = True
+            stack.append((node, True))
+            for successor, extra in forward(node):
+                if successor is not None and not visited[successor]:
+                    stack.append((successor, False))
+        order.reverse()
+        position = {node: index for index, node in enumerate(order)}
+
+        # Loops, innermost (smallest body) first: Add the cycles of the further iterations to the header
+        loops = []
+        for tail, header, extra in backEdges:
+            body = set([header])
+            pending = [tail]
+            while pending:
+                node = pending.pop()
+                if node in body:
+                    continue
+                body.add(node)
+                pending.extend(predecessor for predecessor in range(len(code))
+                               if any(successor == node for successor, unused in edges[predecessor]))
+            loops.append((len(body), tail, header, extra, body))
+        loops.sort(key=lambda loop: loop[0])
+        for unused, tail, header, extra, body in loops:
+            address = code[header].address
+            bound = self.loopBounds.get(address, self.defaultLoopBound)
+            if bound is None:
+                raise AnalysisError('loop at 0x%x in %s needs --loop-bound 0x%x=N' % (address, name, address))
+            # Longest path header -> tail inside the body
+            longest = {header: weights[header]}
+            for node in sorted(body, key=lambda n: position.get(n, 0)):
+                if node not in longest:
+                    continue
+                for successor, edgeExtra in forward(node):
+                    if successor in body and successor != header:
+                        value = longest[node] + edgeExtra + weights[successor]
+                        if value > longest.get(successor, -1):
+                            longest[successor] = value
+            if tail not in longest:
+                raise AnalysisError('loop at 0x%x in %s is not reducible' % (address, name))
+            weights[header] += (bound - 1) * (longest[tail] + extra)
+
+        # Longest path from the entry to an exit
+        best = {0: weights[0]}
+        previous = {}
+        exitCost = -1
+        exitNode = None
+        for node in order:
+            if node not in best:
+                continue
+            for successor, extra in forward(node):
+                if successor is None:
+                    if best[node] + extra > exitCost:
+                        exitCost = best[node] + extra
+                        exitNode = node
+                    continue
+                value = best[node] + extra + weights[successor]
+                if value > best.get(successor, -1):
+                    best[successor] = value
+                    previous[successor] = node
+        if exitNode is None:
+            raise AnalysisError('%s has no reachable return' % name)
+        # Path as the targets of taken branches, jumps and skips
+        path = []
+        node = exitNode
+        while node is not None:
+            before = previous.get(node)
+            if before is None or before != node - 1:
+                path.append(code[node].address)
+            node = before
+        path.reverse()
+        return exitCost, path
+
+
+def disassemble(filename, objdump):
+    if filename.endswith('.elf'):
+        try:
+            return subprocess.run([objdump, '-d', filename], check=True, capture_output=True, text=True).stdout
+        except (OSError, subprocess.CalledProcessError) as error:
+            raise AnalysisError('%s failed: %s' % (objdump, error))
+    with open(filename) as file:
+        return file.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Static WCET of an AVR ISR from avr-objdump output')
+    parser.add_argument('inputs', nargs='+', help='ELF files or avr-objdump -d output, one for each configuration')
+    parser.add_argument('--function', required=True, help='ISR symbol, for example __vector_5')
+    parser.add_argument('--budget', type=int, help='maximum allowed cycles')
+    parser.add_argument('--isr', action='store_true', help='add worst case interrupt response, instruction in progress and vector jump (11 cycles)')
+    parser.add_argument('--wakeup', type=int, help='add the start-up time of the sleep mode in cycles and the 4 cycles sleep response')
+    parser.add_argument('--loop-bound', action='append', default=[], help='ADDRESS=N')
+    parser.add_argument('--default-loop-bound', type=int, help='N for loops without --loop-bound')
+    parser.add_argument('--mhz', type=float, default=16.0, help='CPU clock in MHz (default 16)')
+    parser.add_argument('--objdump', default='avr-objdump', help='avr-objdump executable')
+    arguments = parser.parse_args()
+
+    loopBounds = {}
+    for entry in arguments.loop_bound:
+        address, bound = entry.split('=')
+        loopBounds[int(address, 0)] = int(bound)
+
+    exceeded = False
+    for filename in arguments.inputs:
+        try:
+            functions, names = parse(disassemble(filename, arguments.objdump))
+            analyzer = Analyzer(functions, names, loopBounds, arguments.default_loop_bound)
+            cycles, path = analyzer.wcet(arguments.function)
+        except AnalysisError as error:
+            print('%s: error: %s' % (filename, error), file=sys.stderr)
+            return 2
+        if arguments.isr:
+            cycles += INTERRUPTRESPONSE + LONGESTINSTRUCTION
+        if arguments.wakeup is not None:
+            cycles += SLEEPRESPONSE + arguments.wakeup
+        status = ''
+        if arguments.budget is not None:
+            if cycles > arguments.budget:
+                status = ' EXCEEDS BUDGET %d' % arguments.budget
+                exceeded = True
+            else:
+                status = ' within budget %d' % arguments.budget
+        print('%s: %s WCET %d cycles (%.2f us at %g MHz)%s' % (filename, arguments.function, cycles,
+              cycles / arguments.mhz, arguments.mhz, status))
+        print('  worst path (entry and targets of taken branches): ' + ' '.join('0x%x' % address for address in path))
+    return 1 if exceeded else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
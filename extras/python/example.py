@@ -0,0 +1,54 @@
+# Decodes a synthetic CLK/DT trace with bounces with the KY040Batch bindings
+# (build the module first, see README.md)
+import array
+import random
+import struct
+
+import ky040batch
+
+STATES = [0b11, 0b01, 0b00, 0b10]  # Clockwise order, starting with the idle state
+
+
+def trace(steps, noise, seed=1):
+    """Returns samples of a random walk and the true position"""
+    rng = random.Random(seed)
+    samples = array.array("B")
+    phase = 0
+    position = 0
+    for _ in range(steps):
+        direction = 1 if rng.random() < 0.7 else -1
+        for _ in range(4):
+            phase = (phase + direction) & 3
+            for _ in range(rng.randint(6, 12)):
+                state = STATES[phase]
+                if rng.random() < noise:
+                    state ^= 1 << rng.randint(0, 1)  # Single bit error
+                samples.append(state)
+        position += direction
+        samples.extend([STATES[0]] * rng.randint(0, 19))
+    return samples, position
+
+
+samples, position = trace(2000, 0.05)
+
+decoder = ky040batch.Decoder()
+events = decoder.decode(samples)
+print("true position:", position, "decoded:", decoder.position, "steps:", len(events),
+      "corrected samples:", decoder.corrected)
+print("first steps (sample, step, confidence):", events[:3])
+
+# The same without copies into caller-owned buffers (NumPy arrays work the same way)
+decoder = ky040batch.Decoder()
+work = bytearray(len(samples))
+size_t = "L" if array.array("L").itemsize == struct.calcsize("N") else "Q"
+event_samples = array.array(size_t, [0] * len(events))
+event_steps = array.array("b", [0] * len(events))
+event_confidences = array.array("B", [0] * len(events))
+found = decoder.decode_into(samples, work, event_samples, event_steps, event_confidences)
+same = list(zip(event_samples[:found], event_steps[:found], event_confidences[:found])) == events
+print("decode_into():", found, "steps,", "same as decode()" if same else "DIFFERENT from decode()")
+
+# Too short buffers do not lose steps silently
+decoder = ky040batch.Decoder()
+found = decoder.decode_into(samples, work, event_samples[:10], event_steps[:10], event_confidences[:10])
+print("decode_into() with 10 items:", found, "steps,", decoder.unreported, "unreported")
@@ -0,0 +1,247 @@
+/*
+ * Python bindings for KY040Batch (CPython C-API, no other dependencies)
+ *
+ * The module decodes captured CLK/DT samples with the same C++ code as on the
+ * Arduino. Samples are read with the buffer protocol without copying (bytes,
+ * bytearray, array.array('B'), NumPy uint8 arrays, ...). decode_into() writes
+ * the steps into caller-owned buffers, for example NumPy arrays, also without
+ * copying.
+ *
+ * Build (from this directory):
+ *   python3 setup.py build_ext --inplace
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <KY040Batch.h>
+#include <new>
+
+typedef struct {
+  PyObject_HEAD
+  KY040Batch *decoder;
+  byte *work; // Work buffer for decode(), grows with the largest buffer
+  size_t workSize;
+} DecoderObject;
+
+// Gets a C-contiguous buffer with the item size and the format characters (NULL = any format)
+static bool getBuffer(PyObject *object, Py_buffer *view, bool writable, Py_ssize_t itemSize, const char *formats, const char *name)
+{
+  int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+  if (PyObject_GetBuffer(object, view, flags) != 0) return false;
+  const char *format = (view->format == NULL) ? "B" : view->format;
+  if ((format[0] == '@') || (format[0] == '=') || (format[0] == '<')) format++; // Native or little endian
+  bool formatOk = (formats == NULL) || ((format[0] != '\0') && (format[1] == '\0') && (strchr(formats, format[0]) != NULL));
+  if ((view->itemsize != itemSize) || !formatOk) {
+    PyErr_Format(PyExc_TypeError, "%s: buffer with %zd byte items (format '%s') expected", name, itemSize, (formats == NULL) ? "any" : formats);
+    PyBuffer_Release(view);
+    return false;
+  }
+  return true;
+}
+
+// Grows the work buffer of decode()
+static bool reserveWork(DecoderObject *self, size_t count)
+{
+  if (count <= self->workSize) return true;
+  byte *work = (byte *) PyMem_Realloc(self->work, count);
+  if (work == NULL) {
+    PyErr_NoMemory();
+    return false;
+  }
+  self->work = work;
+  self->workSize = count;
+  return true;
+}
+
+static int Decoder_init(DecoderObject *self, PyObject *args, PyObject *kwargs)
+{
+  static const char *c_keywords[] = { "step", "skip", "one_bit", "two_bits", NULL };
+  unsigned char step = 4;
+  unsigned char skip = 12;
+  unsigned char oneBit = 6;
+  unsigned char twoBits = 14;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|bbbb", (char **) c_keywords, &step, &skip, &oneBit, &twoBits)) return -1;
+  KY040BatchModel model = { step, skip, oneBit, twoBits };
+  delete self->decoder;
+  self->decoder = new (std::nothrow) KY040Batch(model);
+  if (self->decoder == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  return 0;
+}
+
+static void Decoder_dealloc(DecoderObject *self)
+{
+  delete self->decoder;
+  PyMem_Free(self->work);
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static bool checkDecoder(DecoderObject *self)
+{
+  if (self->decoder != NULL) return true;
+  PyErr_SetString(PyExc_RuntimeError, "Decoder is not initialized");
+  return false;
+}
+
+// decode(samples) -> list of (sample, step, confidence)
+static PyObject *Decoder_decode(DecoderObject *self, PyObject *args)
+{
+  PyObject *samplesObject;
+  if (!PyArg_ParseTuple(args, "O", &samplesObject) || !checkDecoder(self)) return NULL;
+  Py_buffer samples;
+  if (!getBuffer(samplesObject, &samples, false, 1, NULL, "samples")) return NULL;
+  size_t count = samples.len;
+  // Enough events for all steps, even when each second sample finishes a step
+  size_t maxEvents = KY040BATCHMAXEVENTS(count);
+  KY040BatchEvent *events = (KY040BatchEvent *) PyMem_Malloc(maxEvents * sizeof(KY040BatchEvent));
+  if ((events == NULL) || !reserveWork(self, count)) {
+    PyMem_Free(events);
+    PyBuffer_Release(&samples);
+    if (!PyErr_Occurred()) PyErr_NoMemory();
+    return NULL;
+  }
+  size_t found = self->decoder->decode((const byte *) samples.buf, count, self->work, events, maxEvents);
+  PyBuffer_Release(&samples);
+
+  PyObject *result = PyList_New(found);
+  for (size_t i=0;(result != NULL) && (i<found);i++) {
+    PyObject *event = Py_BuildValue("(nii)", (Py_ssize_t) events[i].sample,
+      (events[i].direction == KY040Directions::CLOCKWISE) ? 1 : -1, events[i].confidence);
+    if (event == NULL) Py_CLEAR(result); else PyList_SET_ITEM(result, i, event);
+  }
+  PyMem_Free(events);
+  return result;
+}
+
+// Buffers of decode_into()
+struct bufferSpec {
+  bool writable;
+  Py_ssize_t itemSize;
+  const char *formats;
+  const char *name;
+};
+
+static const bufferSpec c_intoBuffers[5] = {
+  { false, 1, NULL, "samples" },
+  { true, 1, NULL, "work" },
+  { true, sizeof(size_t), (sizeof(size_t) == 8) ? "QLN" : "ILN", "event_samples" },
+  { true, 1, "b", "event_steps" },
+  { true, 1, "B", "event_confidences" }
+};
+
+// decode_into(samples, work, event_samples, event_steps, event_confidences) -> number of steps
+static PyObject *Decoder_decode_into(DecoderObject *self, PyObject *args)
+{
+  PyObject *objects[5];
+  if (!PyArg_ParseTuple(args, "OOOOO", &objects[0], &objects[1], &objects[2], &objects[3], &objects[4]) || !checkDecoder(self)) return NULL;
+  Py_buffer views[5];
+  byte ready = 0;
+  while ((ready < 5) && getBuffer(objects[ready], &views[ready], c_intoBuffers[ready].writable,
+    c_intoBuffers[ready].itemSize, c_intoBuffers[ready].formats, c_intoBuffers[ready].name)) ready++;
+  PyObject *result = NULL;
+  if (ready == 5) {
+    size_t count = views[0].len;
+    size_t maxEvents = views[2].len / sizeof(size_t);
+    if ((size_t) views[3].len < maxEvents) maxEvents = views[3].len;
+    if ((size_t) views[4].len < maxEvents) maxEvents = views[4].len;
+    if ((size_t) views[1].len < count) PyErr_SetString(PyExc_ValueError, "work: at least one byte for each sample expected");
+    else {
+      size_t found = self->decoder->decodeArrays((const byte *) views[0].buf, count, (byte *) views[1].buf,
+        (size_t *) views[2].buf, (signed char *) views[3].buf, (byte *) views[4].buf, maxEvents);
+      result = PyLong_FromSize_t(found);
+    }
+  }
+  for (byte i=0;i<ready;i++) PyBuffer_Release(&views[i]);
+  return result;
+}
+
+static PyObject *Decoder_get_position(DecoderObject *self, void *)
+{
+  if (!checkDecoder(self)) return NULL;
+  return PyLong_FromLong(self->decoder->getPosition());
+}
+
+static PyObject *Decoder_get_corrected(DecoderObject *self, void *)
+{
+  if (!checkDecoder(self)) return NULL;
+  return PyLong_FromUnsignedLong(self->decoder->getCorrectedCount());
+}
+
+static PyObject *Decoder_get_skipped(DecoderObject *self, void *)
+{
+  if (!checkDecoder(self)) return NULL;
+  return PyLong_FromUnsignedLong(self->decoder->getSkippedCount());
+}
+
+static PyObject *Decoder_get_unreported(DecoderObject *self, void *)
+{
+  if (!checkDecoder(self)) return NULL;
+  return PyLong_FromUnsignedLong(self->decoder->getUnreportedCount());
+}
+
+static PyMethodDef c_decoderMethods[] = {
+  { "decode", (PyCFunction) Decoder_decode, METH_VARARGS,
+    "decode(samples) -> list of (sample, step, confidence)\n\n"
+    "Decodes a buffer of CLK/DT samples (one byte each, left bit is for CLK, right bit is for DT).\n"
+    "step is +1 for clockwise and -1 for counter-clockwise, confidence is 0..255.\n"
+    "The decoder state is kept for the next buffer." },
+  { "decode_into", (PyCFunction) Decoder_decode_into, METH_VARARGS,
+    "decode_into(samples, work, event_samples, event_steps, event_confidences) -> number of steps\n\n"
+    "Like decode(), but without copying: work is a writable uint8 buffer with at least len(samples) bytes,\n"
+    "the steps are written into writable buffers of size_t (for example numpy.uintp), int8 and uint8 items.\n"
+    "Further steps are counted in the position and in unreported. Buffers with len(samples)//2+1 items fit all steps." },
+  { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef c_decoderProperties[] = {
+  { (char *) "position", (getter) Decoder_get_position, NULL, (char *) "Sum of all decoded steps", NULL },
+  { (char *) "corrected", (getter) Decoder_get_corrected, NULL, (char *) "Number of samples, which did not match the decoded state", NULL },
+  { (char *) "skipped", (getter) Decoder_get_skipped, NULL, (char *) "Number of decoded transitions over two states (missed samples)", NULL },
+  { (char *) "unreported", (getter) Decoder_get_unreported, NULL, (char *) "Number of steps, which did not fit into the buffers of decode_into()", NULL },
+  { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject s_decoderType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "ky040batch.Decoder", // tp_name
+};
+
+static PyModuleDef s_module = {
+  PyModuleDef_HEAD_INIT,
+  "ky040batch",
+  "Maximum likelihood decoder for KY-040 CLK/DT sample buffers (KY040Batch)",
+  -1,
+  NULL, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_ky040batch(void)
+{
+  s_decoderType.tp_basicsize = sizeof(DecoderObject);
+  s_decoderType.tp_flags = Py_TPFLAGS_DEFAULT;
+  s_decoderType.tp_doc = "Decoder(step=4, skip=12, one_bit=6, two_bits=14)\n\n"
+    "Maximum likelihood decoder with the cost model of KY040BatchModel (higher cost = less likely).";
+  s_decoderType.tp_new = PyType_GenericNew;
+  s_decoderType.tp_init = (initproc) Decoder_init;
+  s_decoderType.tp_dealloc = (destructor) Decoder_dealloc;
+  s_decoderType.tp_methods = c_decoderMethods;
+  s_decoderType.tp_getset = c_decoderProperties;
+  if (PyType_Ready(&s_decoderType) < 0) return NULL;
+
+  PyObject *module = PyModule_Create(&s_module);
+  if (module == NULL) return NULL;
+  Py_INCREF(&s_decoderType);
+  if (PyModule_AddObject(module, "Decoder", (PyObject *) &s_decoderType) < 0) {
+    Py_DECREF(&s_decoderType);
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
+}
@@ -0,0 +1,21 @@
+# Build of the Python bindings for KY040Batch (from this directory):
+#   python3 setup.py build_ext --inplace
+import os
+from setuptools import setup, Extension
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+setup(
+    name="ky040batch",
+    version="1.1.0",
+    description="Maximum likelihood decoder for KY-040 CLK/DT sample buffers (KY040Batch)",
+    license="BSD-2-Clause",
+    ext_modules=[
+        Extension(
+            "ky040batch",
+            sources=[os.path.join(here, "ky040batch.cpp")],
+            include_dirs=[os.path.join(here, "..", "..", "src")],
+            language="c++",
+        )
+    ],
+)
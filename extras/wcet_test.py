@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+Regression test for ky040_wcet.py with the hand-written listing wcet_test.lst
+
+The listing contains:
+  __vector_5  ISR with a skip over a one-word and a two-word instruction and a
+              call of helper: push 2 + lds 2 + sbrc/subi 2 + sbrs 1 +
+              call 4 + helper + sts 2 + pop 2 + reti 4 = 19 + helper
+  helper      Loop with the header at 0x142 and a tail call of tail:
+              ldi 1 + N*dec 1 + (N-1)*brne 2 + brne 1 + jmp 3 + tail 4
+              = 3*N + 7 (16 for N=3, 22 for N=5)
+  tail        ret 4
+  skips       The skip paths are the longest paths: sbrc 1 + skip 1 + sbrs 1 +
+              skip 2 (two-word jmp) + 8 nop + ret 4 = 17
+  indirect    ijmp, which cannot be analyzed
+
+Run (from the repository root):
+  python3 extras/wcet_test.py
+
+License: 2-Clause BSD License
+Copyright (c) 2024 codingABI
+For details see: LICENSE.txt
+
+Home: https://github.com/codingABI/KY040
+"""
+
+import os
+import re
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOL = os.path.join(HERE, 'ky040_wcet.py')
+LISTING = os.path.join(HERE, 'wcet_test.lst')
+
+failed = 0
+
+
+def run(*arguments, inputs=None):
+    """Returns (exit code, list of WCET cycles) of ky040_wcet.py"""
+    result = subprocess.run([sys.executable, TOOL] + (inputs or [LISTING]) + list(arguments),
+                            capture_output=True, text=True)
+    return result.returncode, [int(cycles) for cycles in re.findall(r'WCET (\d+) cycles', result.stdout)]
+
+
+def check(name, value, expected):
+    global failed
+    ok = (value == expected)
+    if not ok:
+        failed += 1
+    print('%-58s %8s %8s   %s' % (name, value, expected, 'ok' if ok else 'FAILED'))
+
+
+print('%-58s %8s %8s' % ('check', 'value', 'expected'))
+
+code, cycles = run('--function', 'tail')
+check('ret: cycles', cycles, [4])
+
+code, cycles = run('--function', 'helper', '--loop-bound', '0x142=3')
+check('loop with 3 iterations and tail call: cycles', cycles, [16])
+code, cycles = run('--function', 'helper', '--default-loop-bound', '5')
+check('loop with the default bound 5: cycles', cycles, [22])
+code, cycles = run('--function', 'helper')
+check('loop without bound: exit code', code, 2)
+
+code, cycles = run('--function', 'skips')
+check('skips over a one-word and a two-word instruction: cycles', cycles, [17])
+
+code, cycles = run('--function', '__vector_5', '--loop-bound', '0x142=3')
+check('ISR with skips and call: cycles', cycles, [35])
+check('ISR with skips and call: exit code', code, 0)
+code, cycles = run('--function', '__vector_5', '--loop-bound', '0x142=3', '--isr')
+check('ISR with --isr (+4 response +4 in progress +3 jmp): cycles', cycles, [46])
+code, cycles = run('--function', '__vector_5', '--loop-bound', '0x142=3', '--isr', '--wakeup', '16384')
+check('ISR with --isr --wakeup 16384 (+4 sleep response): cycles', cycles, [16434])
+
+code, cycles = run('--function', '__vector_5', '--loop-bound', '0x142=3', '--budget', '35')
+check('budget 35: exit code', code, 0)
+code, cycles = run('--function', '__vector_5', '--loop-bound', '0x142=3', '--budget', '34')
+check('budget 34 (overrun): exit code', code, 1)
+code, cycles = run('--function', '__vector_5', '--default-loop-bound', '3', '--budget', '40',
+                   inputs=[LISTING, LISTING])
+check('two inputs within budget: exit code', code, 0)
+code, cycles = run('--function', '__vector_5', '--default-loop-bound', '5', '--budget', '40')
+check('default bound 5 (41 cycles), budget 40: exit code', code, 1)
+
+code, cycles = run('--function', 'indirect')
+check('indirect jump: exit code', code, 2)
+code, cycles = run('--function', 'missing')
+check('unknown function: exit code', code, 2)
+
+print('\n%s (%d failed)' % ('All checks passed' if failed == 0 else 'CHECKS FAILED', failed))
+sys.exit(0 if failed == 0 else 1)
@@ -42,34 +42,185 @@
  * @author codingABI https://github.com/codingABI/
  * @copyright 2-Clause BSD License
  * @file KY040.h
- * @version 1.0.1
+ * @version 1.1.0
  */
 #pragma once
 
 /** Library version */
-#define KY040_VERSION "1.0.1"
+#define KY040_VERSION "1.1.0"
 
 #include <arduino.h>
+#include "KY040Directions.h"
+#include "KY040Histogram.h"
+
+#if defined(KY040_USE_CLOCK)
+// Compensated time of the clock prescaler control (KY040_USE_CLOCK must be the same in all translation units)
+#include "KY040Clock.h"
+#endif
+
+#ifndef KY040_MILLIS
+/** Time source in milliseconds for the library. Define it before including KY040.h to use another time source (see KY040_USE_CLOCK in KY040Clock.h) */
+#define KY040_MILLIS() millis()
+#endif
+
+#ifndef KY040_MICROS
+/** Time source in microseconds for the step timestamps. Define it before including KY040.h to use another time source (see KY040_USE_CLOCK in KY040Clock.h) */
+#define KY040_MICROS() micros()
+#endif
 
 /** When using sleep modes wait X milliseconds for next sleep after a CLK/DT sequence start do prevent missing signals */
 #define PREVENTSLEEPMS 150
-// Pin idle state
-#define INITSTEP 0b11
 // Max steps for a signal sequence
 #define MAXSEQUENCESTEPS 4
 
-/** Class for a KY-040 rotary encoder */
-class KY040 {
+// CLK/DT sequences are shared by all rotary encoders (and KY040Generator) instead of a copy in each object
+// CLK/DT sequence for a clockwise rotation (One byte instead of a byte array would be enough for the four 2-bit values, but are harder to read)
+static const byte c_signalSequenceCW[MAXSEQUENCESTEPS] = {0b01,0b00,0b10,INITSTEP};
+// CLK/DT sequence for a counter-clockwise rotation (One byte instead of a byte array would be enough for the four 2-bit values, but are harder to read)
+static const byte c_signalSequenceCCW[MAXSEQUENCESTEPS] = {0b10,0b00,0b01,INITSTEP};
+
+class KY040;
+
+/** Maximum number of watchpoint values (one bit for each value in the crossed flags) */
+#define KY040MAXWATCHPOINTS 32
+
+/**
+ * Deadband notification for a KY040 position
+ *
+ * A consumer (for example a network sync, EEPROM or a slow display) is only notified, when the position
+ * has moved at least a number of steps from the last acknowledged position or when the position has 
+ * changed and the rotary encoder was idle for a time. Attach it with KY040::attachDeadband().
+ */
+class KY040Deadband {
   public:
-      /** Rotation states */
-    enum directions 
-    { 
-      IDLE, /**< Rotary encoder is idle */
-      ACTIVE, /**< Rotary encoder is rotating, but the CLK/DT sequence has not finished */
-      CLOCKWISE, /**< CLK/DT sequence for one step clockwise rotation has finished */
-      COUNTERCLOCKWISE /**< CLK/DT sequence for one step counter-clockwise rotation has finished */
-    };
+    /**@brief
+     * Constructor of a deadband notification
+     *
+     * @param[in] steps Notify, when the position has moved at least this number of steps from the acknowledged position
+     * @param[in] settleMillis Notify, when the position has changed and no step was finished for this time in milliseconds (0 = disabled)
+     */
+    KY040Deadband(int steps, unsigned long settleMillis = 0)
+    {
+      m_steps = steps;
+      m_settleMillis = settleMillis;
+      m_encoder = NULL;
+      m_next = NULL;
+      m_acknowledged = 0;
+      m_upper = steps;
+      m_lower = -steps;
+      v_pending = false;
+    }
+
+    bool available();
+    int acknowledge();
+  private:
+    friend class KY040;
+    int m_steps;
+    unsigned long m_settleMillis;
+    KY040 *m_encoder;
+    KY040Deadband *m_next;
+    int m_acknowledged;
+    int m_upper; // Position reached by a clockwise step, which triggers the notification
+    int m_lower; // Position reached by a counter-clockwise step, which triggers the notification
+    volatile bool v_pending;
+};
+
+/**
+ * Watchpoints for a KY040 position
+ *
+ * A watchpoint is crossed clockwise, when the position reaches its value, and counter-clockwise, when the 
+ * position falls below its value. The values are sorted once when attached with KY040::attachWatchpoints(),
+ * then the ISR only compares the position with the next value above and below. A crossing sets a flag and 
+ * calls an optional callback (called inside the ISR, so keep it short).
+ */
+class KY040Watchpoints {
+  public:
+    /**@brief
+     * Constructor of watchpoints
+     *
+     * @param[in] values Array of watchpoint values (will be sorted in place)
+     * @param[in] count Number of values in the array (max. KY040MAXWATCHPOINTS, larger counts use only the first KY040MAXWATCHPOINTS values)
+     * @param[in] callback Function called inside the ISR (or setPosition()) with the index of the sorted value and KY040::CLOCKWISE or KY040::COUNTERCLOCKWISE (NULL = no callback)
+     */
+    KY040Watchpoints(int values[], byte count, void (*callback)(byte index, byte direction) = NULL)
+    {
+      m_values = values;
+      m_count = (count > KY040MAXWATCHPOINTS) ? KY040MAXWATCHPOINTS : count; // Bit for each value in v_crossed
+      m_callback = callback;
+      m_level = 0;
+      v_crossed = 0;
+    }
+
+    /**@brief
+     * Get and reset flags of crossed watchpoints (Do not use inside ISR)
+     *
+     * @returns Bit mask with one bit for each sorted value, which was crossed in any direction since the last call
+     */
+    unsigned long getAndResetCrossed()
+    {
+      cli();
+      unsigned long result = v_crossed;
+      v_crossed = 0;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get number of watchpoint values less or equal to the position (Do not use inside ISR)
+     *
+     * @returns Number of values less or equal to the position, for example 1, when the position is between the first and second sorted value
+     */
+    byte getLevel()
+    {
+      cli();
+      byte result = m_level;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get a watchpoint value
+     *
+     * @param[in] index Index of the sorted value
+     *
+     * @returns Value
+     */
+    int getValue(byte index)
+    {
+      return m_values[index];
+    }
+  private:
+    friend class KY040;
+
+    // Sorts values and sets the level for the position (called with disabled interrupts)
+    void begin(int position)
+    {
+      for (byte i=1;i<m_count;i++) { // Insertion sort, done only once
+        int value = m_values[i];
+        byte j = i;
+        while ((j > 0) && (m_values[j-1] > value)) {
+          m_values[j] = m_values[j-1];
+          j--;
+        }
+        m_values[j] = value;
+      }
+      m_level = 0;
+      while ((m_level < m_count) && (m_values[m_level] <= position)) m_level++;
+    }
+
+    void stepClockwise(int position);
+    void stepCounterClockwise(int position);
+
+    int *m_values;
+    byte m_count;
+    void (*m_callback)(byte index, byte direction);
+    byte m_level; // Number of values less or equal to the position
+    volatile unsigned long v_crossed;
+};
 
+/** Class for a KY-040 rotary encoder */
+class KY040 : public KY040Directions {
+  public:
     /**@brief
      * Constructor of a the KY-040 rotary encoder
      *
@@ -82,10 +233,55 @@ class KY040 {
       m_dt_pin = dt_pin; // aka. B
       v_state = 255;
       v_lastResult = IDLE;
-      v_lastSequenceStartMillis = millis();
+      v_lastSequenceStartMillis = 0; // millis() is not running, when global objects are constructed
       v_sequenceStep = 0;
       v_direction = IDLE;
       v_oldState = INITSTEP;
+      v_edgeCount = 0;
+      v_position = 0;
+      v_lastStepMillis = 0;
+      v_lastStepMicros = 0;
+      v_latencyPending = false;
+      m_latency = NULL;
+      m_deadbands = NULL;
+      m_watchpoints = NULL;
+      v_stepCount = 0;
+      v_rejectedCount = 0;
+      v_abortedCount = 0;
+      #if defined(__AVR__)
+      m_clkInputRegister = NULL;
+      m_dtInputRegister = NULL;
+      #endif
+      #if defined(PCIFR)
+      m_pinChangeFlagMask = 0;
+      #endif
+    }
+
+    /**@brief
+     * Synchronizes the rotary encoder with the current pin states. Call it in setup() after pinMode().
+     *
+     * Global objects are constructed before the Arduino core is initialized, so the constructor cannot 
+     * read the pins or millis(). begin() seeds the stored CLK/DT state with the current pin states,
+     * so the first edge after boot is decoded against the real previous state, and starts the timing 
+     * for readyForSleep(). On AVR the input registers for CLK and DT are cached, so getRotation() reads 
+     * the pins without digitalRead().
+     */
+    void begin()
+    {
+      #if defined(__AVR__)
+      m_clkInputRegister = portInputRegister(digitalPinToPort(m_clk_pin));
+      m_clkBitMask = digitalPinToBitMask(m_clk_pin);
+      m_dtInputRegister = portInputRegister(digitalPinToPort(m_dt_pin));
+      m_dtBitMask = digitalPinToBitMask(m_dt_pin);
+      #endif
+      byte state = readState();
+      cli();
+      v_state = state;
+      v_oldState = state;
+      v_sequenceStep = 0;
+      v_direction = IDLE;
+      v_lastSequenceStartMillis = KY040_MILLIS() - PREVENTSLEEPMS - 1;
+      sei();
     }
 
     /**@brief
@@ -102,62 +298,57 @@ class KY040 {
     byte checkRotation() 
     {
       byte result = IDLE;
-   
-      if (v_state != v_oldState) { // State changed?
-        if (v_sequenceStep == 0) { // Check for begin of rotation
-          if (v_state == c_signalSequenceCW[0]) { // Begin of CW
-            v_direction=CLOCKWISE;
-            v_sequenceStep = 1;
-            v_lastSequenceStartMillis = millis();
-          }
-          if (v_state == c_signalSequenceCCW[0]) { // Begin of CCW
-            v_direction=COUNTERCLOCKWISE; 
-            v_sequenceStep = 1;
-            v_lastSequenceStartMillis = millis();
+      // Work on local copies, because every access to a volatile member is a separate load or store
+      byte state = v_state;
+      unsigned long currentMillis = KY040_MILLIS();
+      unsigned long lastSequenceStartMillis = v_lastSequenceStartMillis;
+
+      if (state != v_oldState) { // State changed?
+        byte sequenceStep = v_sequenceStep;
+        byte direction = v_direction;
+        if (sequenceStep == 0) { // Check for begin of rotation
+          if (state == c_signalSequenceCW[0]) { // Begin of CW
+            direction = CLOCKWISE;
+            sequenceStep = 1;
+            lastSequenceStartMillis = currentMillis;
+            v_lastSequenceStartMillis = lastSequenceStartMillis;
+          } else if (state == c_signalSequenceCCW[0]) { // Begin of CCW
+            direction = COUNTERCLOCKWISE; 
+            sequenceStep = 1;
+            lastSequenceStartMillis = currentMillis;
+            v_lastSequenceStartMillis = lastSequenceStartMillis;
           }
         } else {
-          switch (v_direction) {
-            case CLOCKWISE:
-              if (v_state == c_signalSequenceCW[v_sequenceStep]) {
-                v_sequenceStep++;
-                if (v_sequenceStep >= MAXSEQUENCESTEPS) { // Sequence has finished
-                  result=v_direction;
-                  v_lastResult=result;
-                  v_direction=IDLE;
-                  v_sequenceStep=0;
-                } else result=ACTIVE;
-              } else { 
-                // Invalid sequence
-                if (v_state == INITSTEP) { // Reset sequence in init state
-                  v_direction=IDLE;
-                  v_sequenceStep=0;
-                }
-              }
-              break;
-            case COUNTERCLOCKWISE:
-              if (v_state == c_signalSequenceCCW[v_sequenceStep]) {
-                v_sequenceStep++;
-                if (v_sequenceStep >= MAXSEQUENCESTEPS) { // Sequence has finished
-                  result=v_direction;
-                  v_lastResult=result;
-                  v_direction=IDLE;
-                  v_sequenceStep=0;
-                } else result=ACTIVE;
-              } else { 
-                // Invalid sequence
-                if (v_state == INITSTEP) { // Reset sequence in init state
-                  v_direction=IDLE;
-                  v_sequenceStep=0;
-                }
-              }
-              break;
+          // CLOCKWISE or COUNTERCLOCKWISE, because a running sequence always has a direction
+          const byte *sequence = (direction == CLOCKWISE) ? c_signalSequenceCW : c_signalSequenceCCW;
+          if (state == sequence[sequenceStep]) {
+            sequenceStep++;
+            if (sequenceStep >= MAXSEQUENCESTEPS) { // Sequence has finished
+              result = direction;
+              v_lastResult = result;
+              finishStep(result, currentMillis);
+              direction = IDLE;
+              sequenceStep = 0;
+            } else result = ACTIVE;
+          } else { 
+            // Invalid sequence
+            v_rejectedCount++;
+            if (state == INITSTEP) { // Reset sequence in init state
+              v_abortedCount++;
+              direction = IDLE;
+              sequenceStep = 0;
+            }
           }
         }
-        v_oldState = v_state;
+        // Publish decoder state once
+        v_edgeCount++;
+        v_sequenceStep = sequenceStep;
+        v_direction = direction;
+        v_oldState = state;
       }
       // Prevent unsigned long overrun
-      if (millis() - v_lastSequenceStartMillis > PREVENTSLEEPMS) {
-          v_lastSequenceStartMillis = millis() - PREVENTSLEEPMS - 1;
+      if (currentMillis - lastSequenceStartMillis > PREVENTSLEEPMS) {
+          v_lastSequenceStartMillis = currentMillis - PREVENTSLEEPMS - 1;
       }
       return result;
     }
@@ -165,6 +356,8 @@ class KY040 {
     /**@brief
      * Get and reset last finished rotation step (Do not use inside ISR)
      *
+     * With an attached latency histogram the time from the end of the step to this call is recorded (see attachLatencyHistogram())
+     *
      * @retval KY040::CLOCKWISE        CLK/DT sequence for one step clockwise rotation has finished
      * @retval KY040::COUNTERCLOCKWISE CLK/DT sequence for one step counter-clockwise rotation has finished
      * @retval KY040::IDLE             Rotary encoder is idle
@@ -175,13 +368,208 @@ class KY040 {
       byte result = v_lastResult;
       v_lastResult = IDLE;
       sei();
+      recordLatency();
+      return result;
+    }
+
+    /**@brief
+     * Get time of the last finished step (Do not use inside ISR)
+     *
+     * The time is only taken with an attached latency histogram, so the ISR does not read the clock without need
+     *
+     * @returns KY040_MICROS() (default micros()) at the end of the CLK/DT sequence of the last step (0 without attached latency histogram)
+     */
+    unsigned long getLastStepMicros()
+    {
+      cli();
+      unsigned long result = v_lastStepMicros;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Attach a histogram for the latency from the end of a step to the first read of the result (Do not use inside ISR)
+     *
+     * Measured reads are getAndResetLastRotation(), getPosition(), getPositionFixed() and KY040Deadband::acknowledge().
+     * getRotation() is not measured, because it finishes the step itself. Each step is recorded once by the first
+     * measured read after it. When several steps finish before a read, only the last step is recorded. Steps finished
+     * before this call are not recorded. The latency includes the time in the ISR after the step, the loop period and
+     * critical sections of your sketch.
+     *
+     * @param[in] histogram Histogram for the latencies in microseconds
+     */
+    void attachLatencyHistogram(KY040Histogram &histogram)
+    {
+      cli();
+      m_latency = &histogram;
+      v_latencyPending = false; // Steps before have no timestamp
+      sei();
+    }
+
+    /**@brief
+     * Get position (Clockwise steps increase, counter-clockwise steps decrease the position. Do not use inside ISR)
+     *
+     * With an attached latency histogram the time from the end of the last step to this call is recorded (see attachLatencyHistogram())
+     *
+     * @returns Position
+     */
+    int getPosition()
+    {
+      cli();
+      int result = v_position;
+      sei();
+      recordLatency();
+      return result;
+    }
+
+    /**@brief
+     * Get progress of the running CLK/DT sequence in quarter steps (Do not use inside ISR)
+     *
+     * Only reads the decoder state, so the position and the step detection are not changed
+     *
+     * @returns 1..3 for a running clockwise sequence, -1..-3 for a running counter-clockwise sequence, 0 when idle
+     */
+    signed char getProgress()
+    {
+      cli();
+      byte sequenceStep = v_sequenceStep;
+      byte direction = v_direction;
+      sei();
+      return (direction == COUNTERCLOCKWISE) ? -sequenceStep : sequenceStep;
+    }
+
+    /**@brief
+     * Get position with the progress of the running CLK/DT sequence as fixed point value with two fractional bits (Do not use inside ISR)
+     *
+     * For example 4 is the position 1.0 and 6 is the position 1.5. Divide by 4.0 to get the position as float.
+     * With an attached latency histogram the time from the end of the last step to this call is recorded (see attachLatencyHistogram())
+     *
+     * @returns Position * 4 + progress
+     */
+    long getPositionFixed()
+    {
+      cli();
+      int position = v_position;
+      byte sequenceStep = v_sequenceStep;
+      byte direction = v_direction;
+      sei();
+      recordLatency();
+      return (long) position * MAXSEQUENCESTEPS + ((direction == COUNTERCLOCKWISE) ? -sequenceStep : sequenceStep);
+    }
+
+    /**@brief
+     * Set position (Do not use inside ISR)
+     *
+     * Attached deadband notifications are triggered, when the new position is outside their deadband, and their settle time restarts.
+     * Attached watchpoints between the old and new position are flagged as crossed.
+     *
+     * @param[in] position New position
+     */
+    void setPosition(int position)
+    {
+      unsigned long currentMillis = KY040_MILLIS();
+      cli();
+      v_position = position;
+      v_lastStepMillis = currentMillis; // Start of the deadband settle time
+      for (KY040Deadband *deadband = m_deadbands; deadband != NULL; deadband = deadband->m_next) {
+        if ((position >= deadband->m_upper) || (position <= deadband->m_lower)) deadband->v_pending = true;
+      }
+      if (m_watchpoints != NULL) {
+        m_watchpoints->stepClockwise(position);
+        m_watchpoints->stepCounterClockwise(position);
+      }
+      sei();
+    }
+
+    /**@brief
+     * Attach a deadband notification to the position (Do not use inside ISR)
+     *
+     * The current position becomes the acknowledged position of the deadband notification
+     *
+     * @param[in] deadband Deadband notification
+     */
+    void attachDeadband(KY040Deadband &deadband)
+    {
+      cli();
+      deadband.m_encoder = this;
+      deadband.m_next = m_deadbands;
+      m_deadbands = &deadband;
+      sei();
+      deadband.acknowledge();
+    }
+
+    /**@brief
+     * Attach watchpoints to the position (Do not use inside ISR)
+     *
+     * Sorts the watchpoint values. Only one KY040Watchpoints object can be attached to a rotary encoder.
+     *
+     * @param[in] watchpoints Watchpoints
+     */
+    void attachWatchpoints(KY040Watchpoints &watchpoints)
+    {
+      cli();
+      watchpoints.begin(v_position);
+      m_watchpoints = &watchpoints;
+      sei();
+    }
+
+    /**@brief
+     * Get and reset the number of CLK/DT state changes (including bounces) since the last call (Do not use inside ISR)
+     *
+     * @returns Number of CLK/DT state changes seen by checkRotation()
+     */
+    unsigned int getAndResetEdgeCount()
+    {
+      cli();
+      unsigned int result = v_edgeCount;
+      v_edgeCount = 0;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get number of finished steps (Free running counter, use the difference between two calls. Do not use inside ISR)
+     *
+     * @returns Number of finished steps in both directions
+     */
+    unsigned int getStepCount()
+    {
+      cli();
+      unsigned int result = v_stepCount;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get number of rejected CLK/DT states in running sequences (Free running counter, use the difference between two calls. Do not use inside ISR)
+     *
+     * @returns Number of CLK/DT states, which did not match the next state of a running sequence
+     */
+    unsigned int getRejectedCount()
+    {
+      cli();
+      unsigned int result = v_rejectedCount;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get number of aborted sequences (Free running counter, use the difference between two calls. Do not use inside ISR)
+     *
+     * @returns Number of sequences, which returned to the idle state without finishing
+     */
+    unsigned int getAbortedCount()
+    {
+      cli();
+      unsigned int result = v_abortedCount;
+      sei();
       return result;
     }
 
     /**@brief
      * Read and stores current pin state for CLK and DT and returns the current rotation state.
      *
-     * Reads pin state for CLK and DT with DigitalRead() and checks current rotation state by calling checkRotation()
+     * Reads pin state for CLK and DT with DigitalRead() (or the cached input registers on AVR after begin()) and checks current rotation state by calling checkRotation()
      *
      * @retval KY040::CLOCKWISE        CLK/DT sequence for one step clockwise rotation has finished
      * @retval KY040::COUNTERCLOCKWISE CLK/DT sequence for one step counter-clockwise rotation has finished
@@ -190,10 +578,62 @@ class KY040 {
      */
     byte getRotation() 
     { 
-      setState((digitalRead(m_clk_pin)<<1)+digitalRead(m_dt_pin));
+      setState(readState());
       return checkRotation();
     }
 
+#if defined(PCIFR)
+    /**@brief
+     * Enables the pin change flags for CLK and DT without enabling the pin change interrupt (AVR only)
+     *
+     * The PCIFR flag of a pin change group latches every change on CLK or DT, even if the pin change 
+     * interrupt for the group is disabled. Do not enable the pin change interrupt (PCICR) for the group
+     * when using getRotation(pinChangeFlags), because the ISR would clear the flag.
+     */
+    void enablePinChangeFlags()
+    {
+      *digitalPinToPCMSK(m_clk_pin) |= bit(digitalPinToPCMSKbit(m_clk_pin));
+      *digitalPinToPCMSK(m_dt_pin) |= bit(digitalPinToPCMSKbit(m_dt_pin));
+      m_pinChangeFlagMask = bit(digitalPinToPCICRbit(m_clk_pin)) | bit(digitalPinToPCICRbit(m_dt_pin));
+      PCIFR = m_pinChangeFlagMask; // Clear outstanding flags by writing a logical one
+    }
+
+    /**@brief
+     * Get and reset the latched pin change flags of all pin change groups (AVR only)
+     *
+     * Call this once per loop before getRotation(pinChangeFlags) for all rotary encoders. A change after 
+     * this call sets the flag again and will be processed in the next loop.
+     *
+     * @returns Pin change flags from PCIFR
+     */
+    static byte getAndResetPinChangeFlags()
+    {
+      byte flags = PCIFR;
+      PCIFR = flags; // Clear only the flags we have read by writing a logical one
+      return flags;
+    }
+
+    /**@brief
+     * Read and stores current pin state for CLK and DT only, if the pin change flag for CLK or DT is set (AVR only)
+     *
+     * Needs enablePinChangeFlags(). When no flag is set for the pin change groups of CLK or DT 
+     * the pins are not read, but checkRotation() runs with the stored state for the millis() overrun 
+     * prevention of readyForSleep() and returns KY040::IDLE.
+     *
+     * @param[in] pinChangeFlags Pin change flags from getAndResetPinChangeFlags()
+     *
+     * @retval KY040::CLOCKWISE        CLK/DT sequence for one step clockwise rotation has finished
+     * @retval KY040::COUNTERCLOCKWISE CLK/DT sequence for one step counter-clockwise rotation has finished
+     * @retval KY040::IDLE             Rotary encoder is idle
+     * @retval KY040::ACTIVE           Rotary encoder is rotating, but the CLK/DT sequence has not finished
+     */
+    byte getRotation(byte pinChangeFlags)
+    {
+      if (!(pinChangeFlags & m_pinChangeFlagMask)) return checkRotation(); // Stored state has not changed, only the time is checked
+      return getRotation();
+    }
+#endif
+
     /**@brief
      * Get stored pin states for CLK and DT (Left bit is for CLK, right bit is for DT). Should be called from ISR, when needed
      *
@@ -217,7 +657,7 @@ class KY040 {
       cli();
       unsigned long lastStepMillis = v_lastSequenceStartMillis;
       sei();
-      return (millis()-lastStepMillis > PREVENTSLEEPMS);
+      return (KY040_MILLIS()-lastStepMillis > PREVENTSLEEPMS);
     }
 
     /**@brief
@@ -230,6 +670,66 @@ class KY040 {
       v_state = state;
     }
   private:
+    friend class KY040Deadband;
+    friend class KY040Power;
+    friend class KY040ClockPolicy;
+    friend class KY040Task;
+
+    // Like readyForSleep() and no running sequence, but without changing the interrupt state (called with disabled interrupts)
+    bool readyForDeepSleep(unsigned long currentMillis)
+    {
+      return (v_sequenceStep == 0) && (currentMillis - v_lastSequenceStartMillis > PREVENTSLEEPMS);
+    }
+
+    // Records the latency of the last finished step once for the first read after the step (Do not use inside ISR)
+    void recordLatency()
+    {
+      if (m_latency == NULL) return;
+      cli();
+      bool pending = v_latencyPending;
+      v_latencyPending = false;
+      unsigned long lastStepMicros = v_lastStepMicros;
+      sei();
+      if (pending) m_latency->record(KY040_MICROS() - lastStepMicros);
+    }
+
+    // Reads CLK/DT pin states (Left bit is for CLK, right bit is for DT)
+    byte readState()
+    {
+      #if defined(__AVR__)
+      if (m_clkInputRegister != NULL) {
+        return (((*m_clkInputRegister & m_clkBitMask) ? 0b10 : 0) | ((*m_dtInputRegister & m_dtBitMask) ? 0b01 : 0));
+      }
+      #endif
+      return (digitalRead(m_clk_pin)<<1)+digitalRead(m_dt_pin);
+    }
+
+    // Updates position and notifications for a finished step (called from checkRotation())
+    void finishStep(byte direction, unsigned long currentMillis)
+    {
+      int position = v_position;
+      if (direction == CLOCKWISE) {
+        position++;
+        for (KY040Deadband *deadband = m_deadbands; deadband != NULL; deadband = deadband->m_next) {
+          if (position == deadband->m_upper) deadband->v_pending = true;
+        }
+        if (m_watchpoints != NULL) m_watchpoints->stepClockwise(position);
+      } else {
+        position--;
+        for (KY040Deadband *deadband = m_deadbands; deadband != NULL; deadband = deadband->m_next) {
+          if (position == deadband->m_lower) deadband->v_pending = true;
+        }
+        if (m_watchpoints != NULL) m_watchpoints->stepCounterClockwise(position);
+      }
+      v_position = position;
+      v_lastStepMillis = currentMillis;
+      if (m_latency != NULL) { // Only needed for the latency histogram
+        v_lastStepMicros = KY040_MICROS();
+        v_latencyPending = true;
+      }
+      v_stepCount++;
+    }
+
     byte m_clk_pin; // aka. A
     byte m_dt_pin; // aka. B
     volatile byte v_state;
@@ -238,9 +738,88 @@ class KY040 {
     volatile byte v_sequenceStep;
     volatile byte v_direction;
     volatile byte v_oldState;
-    // CLK/DT sequence for a clockwise rotation (One byte instead of a byte array would be enough for the four 2-bit values, but are harder to read)
-    const byte c_signalSequenceCW[MAXSEQUENCESTEPS] = {0b01,0b00,0b10,INITSTEP};
-    // CLK/DT sequence for a counter-clockwise rotation (One byte instead of a byte array would be enough for the four 2-bit values, but are harder to read)
-    const byte c_signalSequenceCCW[MAXSEQUENCESTEPS] = {0b10,0b00,0b01,INITSTEP};    
+    volatile unsigned int v_edgeCount;
+    volatile int v_position;
+    volatile unsigned long v_lastStepMillis;
+    volatile unsigned long v_lastStepMicros; // End of the last step
+    volatile bool v_latencyPending; // Last step was not read since its end
+    KY040Histogram *m_latency;
+    KY040Deadband *m_deadbands;
+    KY040Watchpoints *m_watchpoints;
+    volatile unsigned int v_stepCount;
+    volatile unsigned int v_rejectedCount;
+    volatile unsigned int v_abortedCount;
+    #if defined(__AVR__)
+    volatile byte *m_clkInputRegister; // Cached by begin()
+    volatile byte *m_dtInputRegister; // Cached by begin()
+    byte m_clkBitMask;
+    byte m_dtBitMask;
+    #endif
+    #if defined(PCIFR)
+    byte m_pinChangeFlagMask; // PCIFR bits for the pin change groups of CLK and DT
+    #endif
+};
+
+/**@brief
+ * Checks, if the consumer should be notified (Do not use inside ISR)
+ *
+ * @retval true Position has moved at least the deadband steps from the acknowledged position or has settled after a change
+ * @retval false No notification or not attached to a rotary encoder
+ */
+inline bool KY040Deadband::available()
+{
+  if (m_encoder == NULL) return false;
+  cli();
+  bool pending = v_pending;
+  int position = m_encoder->v_position;
+  unsigned long lastStepMillis = m_encoder->v_lastStepMillis;
+  sei();
+  if (pending) return true;
+  if ((m_settleMillis == 0) || (position == m_acknowledged)) return false;
+  return (KY040_MILLIS() - lastStepMillis >= m_settleMillis);
+}
+
+/**@brief
+ * Acknowledges the current position and resets the notification (Do not use inside ISR)
+ *
+ * With a latency histogram attached to the rotary encoder the time from the end of the last step to this call is recorded
+ *
+ * @returns Current position, which is the new acknowledged position (the last acknowledged position, when not attached to a rotary encoder)
+ */
+inline int KY040Deadband::acknowledge()
+{
+  if (m_encoder == NULL) return m_acknowledged;
+  cli();
+  int position = m_encoder->v_position;
+  m_acknowledged = position;
+  m_upper = position + m_steps;
+  m_lower = position - m_steps;
+  v_pending = false;
+  sei();
+  m_encoder->recordLatency();
+  return position;
+}
+
+// Checks the next watchpoint value above after a clockwise step (called from ISR, m_level < m_count <= KY040MAXWATCHPOINTS before the shift)
+inline void KY040Watchpoints::stepClockwise(int position)
+{
+  while ((m_level < m_count) && (position >= m_values[m_level])) {
+    v_crossed |= 1UL << m_level;
+    if (m_callback != NULL) m_callback(m_level, KY040::CLOCKWISE);
+    m_level++;
+  }
+}
+
+// Checks the next watchpoint value below after a counter-clockwise step (called from ISR, m_level < KY040MAXWATCHPOINTS after the decrement)
+inline void KY040Watchpoints::stepCounterClockwise(int position)
+{
+  while ((m_level > 0) && (position < m_values[m_level-1])) {
+    m_level--;
+    v_crossed |= 1UL << m_level;
+    if (m_callback != NULL) m_callback(m_level, KY040::COUNTERCLOCKWISE);
+  }
+}
 
-};
\ No newline at end of file
+#if defined(KY040_USE_CLOCK)
+#include "KY040ClockPolicy.h"
+#endif
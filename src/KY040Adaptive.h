@@ -0,0 +1,167 @@
+/**
+ * Class: KY040Adaptive
+ *
+ * Description:
+ * Chooses between pin change interrupts and timer sampling for one or more
+ * KY040 rotary encoders depending on the CLK/DT edge rate.
+ * Pin change interrupts are cheapest when the rotary encoders are idle, but
+ * with heavy bounces or fast rotations a fixed-rate timer sampling costs less
+ * CPU time than one ISR call per edge.
+ *
+ * The class only decides the mode and keeps statistics. Enabling and disabling
+ * the pin change interrupts and the timer is done by your sketch, when update()
+ * returns true. Because both ISRs feed the same KY040 objects with setState()
+ * and checkRotation(), no step is lost or counted twice when the mode changes.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Adaptive.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Class to switch between pin change interrupts and timer sampling for KY-040 rotary encoders */
+class KY040Adaptive {
+  public:
+    /** Acquisition modes */
+    enum modes
+    {
+      PINCHANGE, /**< CLK/DT are processed in a pin change ISR */
+      TIMER /**< CLK/DT are sampled in a timer ISR */
+    };
+
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoders Array of rotary encoders
+     * @param[in] count Number of rotary encoders in the array
+     * @param[in] windowMillis Length of the measurement window in milliseconds
+     * @param[in] timerEdges Switch to KY040Adaptive::TIMER, when one rotary encoder has more edges than this in one window
+     * @param[in] pinChangeEdges Switch back to KY040Adaptive::PINCHANGE, when all rotary encoders have less edges than this in one window
+     */
+    KY040Adaptive(KY040 *encoders[], byte count, unsigned int windowMillis, unsigned int timerEdges, unsigned int pinChangeEdges)
+    {
+      m_encoders = encoders;
+      m_count = count;
+      m_windowMillis = windowMillis;
+      m_timerEdges = timerEdges;
+      m_pinChangeEdges = pinChangeEdges;
+      m_mode = PINCHANGE;
+      m_windowStartMillis = 0;
+      m_modeStartMillis = 0;
+      m_switchesToTimer = 0;
+      m_switchesToPinChange = 0;
+      m_millisInMode[PINCHANGE] = 0;
+      m_millisInMode[TIMER] = 0;
+      m_maxEdges = 0;
+    }
+
+    /**@brief
+     * Checks the edge rate at the end of each window and selects the mode (Do not use inside ISR)
+     *
+     * When true is returned, disable the ISR of the old mode and enable the ISR of the new mode (getMode())
+     *
+     * @retval true Mode has changed
+     * @retval false Mode is unchanged
+     */
+    bool update()
+    {
+      unsigned long currentMillis = KY040_MILLIS();
+      if (currentMillis - m_windowStartMillis < m_windowMillis) return false;
+      m_windowStartMillis = currentMillis;
+
+      // Highest edge count of all rotary encoders in this window
+      unsigned int maxEdges = 0;
+      for (byte i=0;i<m_count;i++) {
+        unsigned int edges = m_encoders[i]->getAndResetEdgeCount();
+        if (edges > maxEdges) maxEdges = edges;
+      }
+      m_maxEdges = maxEdges;
+
+      byte mode = m_mode;
+      if ((mode == PINCHANGE) && (maxEdges > m_timerEdges)) mode = TIMER;
+      if ((mode == TIMER) && (maxEdges < m_pinChangeEdges)) mode = PINCHANGE;
+      if (mode == m_mode) return false;
+
+      m_millisInMode[m_mode] += currentMillis - m_modeStartMillis;
+      m_modeStartMillis = currentMillis;
+      if (mode == TIMER) m_switchesToTimer++; else m_switchesToPinChange++;
+      m_mode = mode;
+      return true;
+    }
+
+    /**@brief
+     * Get current mode
+     *
+     * @retval KY040Adaptive::PINCHANGE CLK/DT should be processed in a pin change ISR
+     * @retval KY040Adaptive::TIMER CLK/DT should be sampled in a timer ISR
+     */
+    byte getMode()
+    {
+      return m_mode;
+    }
+
+    /**@brief
+     * Get number of switches from pin change interrupts to timer sampling
+     *
+     * @returns Number of switches
+     */
+    unsigned long getSwitchesToTimer()
+    {
+      return m_switchesToTimer;
+    }
+
+    /**@brief
+     * Get number of switches from timer sampling back to pin change interrupts
+     *
+     * @returns Number of switches
+     */
+    unsigned long getSwitchesToPinChange()
+    {
+      return m_switchesToPinChange;
+    }
+
+    /**@brief
+     * Get milliseconds spent in a mode
+     *
+     * @param[in] mode KY040Adaptive::PINCHANGE or KY040Adaptive::TIMER
+     *
+     * @returns Milliseconds in mode including the currently running mode
+     */
+    unsigned long getMillisInMode(byte mode)
+    {
+      unsigned long result = m_millisInMode[mode];
+      if (mode == m_mode) result += KY040_MILLIS() - m_modeStartMillis;
+      return result;
+    }
+
+    /**@brief
+     * Get highest edge count of one rotary encoder in the last window
+     *
+     * @returns Edge count
+     */
+    unsigned int getLastMaxEdges()
+    {
+      return m_maxEdges;
+    }
+  private:
+    KY040 **m_encoders;
+    byte m_count;
+    byte m_mode;
+    unsigned int m_windowMillis;
+    unsigned int m_timerEdges;
+    unsigned int m_pinChangeEdges;
+    unsigned int m_maxEdges;
+    unsigned long m_windowStartMillis;
+    unsigned long m_modeStartMillis;
+    unsigned long m_switchesToTimer;
+    unsigned long m_switchesToPinChange;
+    unsigned long m_millisInMode[2];
+};
@@ -0,0 +1,307 @@
+/**
+ * Class: KY040Batch
+ *
+ * Description:
+ * Maximum likelihood decoder for buffers of sampled CLK/DT states (for example
+ * filled by a timer ISR). checkRotation() decides edge by edge and drops a whole
+ * step, when a bounce corrupts one state. With a buffer of samples the most
+ * likely sequence of quadrature states can be chosen instead (Viterbi algorithm).
+ *
+ * The hidden states are the four CLK/DT states in clockwise order
+ * 11 -> 01 -> 00 -> 10 -> 11. Each sample costs nothing when it matches the state,
+ * and a configurable cost, when one or both bits differ (bounce/noise). Each
+ * transition costs nothing to stay, a configurable cost for one step to a
+ * neighbour state and a higher cost for two steps (a missed sample). A step
+ * (detent) is reported like checkRotation() does: when the decoded states have
+ * moved four states from the idle state 11 in one direction back to 11.
+ * For each step a confidence is reported: the share of samples of the
+ * sequence, which matched the decoded states.
+ *
+ * Time and work buffer are linear in the number of samples (one byte per sample).
+ *
+ * Without Arduino (ARDUINO not defined) the header only needs the C++ standard
+ * headers and KY040Directions.h, so captured traces can be decoded on a PC
+ * with the same code (see extras/python for Python bindings).
+ * decodeArrays() writes the steps into separate arrays for each field, which
+ * fits buffers of other languages (for example NumPy arrays via bindings).
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Batch.h
+ */
+#pragma once
+
+#include <stddef.h>
+#if defined(ARDUINO)
+#include "KY040.h"
+#else
+#include "KY040Directions.h"
+#endif
+
+/**
+ * Maximum number of steps KY040Batch can find in a buffer of samples. A missed sample moves two states, so a step can
+ * finish every second sample, and a sequence started in the previous buffer (up to three states) adds one step.
+ */
+#define KY040BATCHMAXEVENTS(samples) ((samples)/2 + 1)
+
+// CLK/DT state for each phase of KY040Batch in clockwise order, starting with the idle state
+static const byte c_batchStateOfPhase[4] = {INITSTEP,0b01,0b00,0b10};
+
+/** Cost model for KY040Batch (higher cost = less likely) */
+struct KY040BatchModel {
+  byte step; /**< Cost for a transition to a neighbour state */
+  byte skip; /**< Cost for a transition over two states (missed sample) */
+  byte oneBit; /**< Cost for a sample with one bit different from the state */
+  byte twoBits; /**< Cost for a sample with both bits different from the state */
+};
+
+/** Step found by KY040Batch */
+struct KY040BatchEvent {
+  size_t sample; /**< Index of the sample, which finished the step */
+  byte direction; /**< KY040::CLOCKWISE or KY040::COUNTERCLOCKWISE (KY040Directions) */
+  byte confidence; /**< 0..255, share of samples of the sequence matching the decoded states */
+};
+
+/** Maximum likelihood decoder for buffers of KY-040 CLK/DT samples */
+class KY040Batch {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] model Cost model. A single sample bounce should cost less than two steps (oneBit < 2*step).
+     */
+    KY040Batch(const KY040BatchModel &model)
+    {
+      m_model = model;
+      m_phase = 0; // Idle state 11
+      m_offset = 0;
+      m_lastStep = 1;
+      m_position = 0;
+      m_matches = 0;
+      m_samples = 0;
+      m_corrected = 0;
+      m_skipped = 0;
+      m_unreported = 0;
+    }
+
+    /**@brief
+     * Decodes a buffer of CLK/DT samples. The decoder state is kept for the next buffer.
+     *
+     * @param[in] samples CLK/DT samples (Left bit is for CLK, right bit is for DT)
+     * @param[in] count Number of samples
+     * @param[in] work Work buffer with at least count bytes
+     * @param[out] events Found steps
+     * @param[in] maxEvents Size of the events array (KY040BATCHMAXEVENTS(count) for all steps). Further steps are counted in the position and in getUnreportedCount()
+     *
+     * @returns Number of steps stored in events
+     */
+    size_t decode(const byte samples[], size_t count, byte work[], KY040BatchEvent events[], size_t maxEvents)
+    {
+      eventWriter writer = { events, maxEvents, 0, 0 };
+      run(samples, count, work, writer);
+      m_unreported += writer.unreported;
+      return writer.found;
+    }
+
+    /**@brief
+     * Decodes a buffer of CLK/DT samples into separate arrays for each event field (for example NumPy arrays on a PC, without copying)
+     *
+     * @param[in] samples CLK/DT samples (Left bit is for CLK, right bit is for DT)
+     * @param[in] count Number of samples
+     * @param[in] work Work buffer with at least count bytes
+     * @param[out] eventSamples Index of the sample, which finished the step
+     * @param[out] eventSteps +1 for a clockwise step, -1 for a counter-clockwise step
+     * @param[out] eventConfidences 0..255, share of samples of the sequence matching the decoded states
+     * @param[in] maxEvents Size of each event array (KY040BATCHMAXEVENTS(count) for all steps). Further steps are counted in the position and in getUnreportedCount()
+     *
+     * @returns Number of steps stored in the event arrays
+     */
+    size_t decodeArrays(const byte samples[], size_t count, byte work[], size_t eventSamples[], signed char eventSteps[], byte eventConfidences[], size_t maxEvents)
+    {
+      arrayWriter writer = { eventSamples, eventSteps, eventConfidences, maxEvents, 0, 0 };
+      run(samples, count, work, writer);
+      m_unreported += writer.unreported;
+      return writer.found;
+    }
+
+    /**@brief
+     * Get position (sum of all decoded steps)
+     *
+     * @returns Position
+     */
+    long getPosition()
+    {
+      return m_position;
+    }
+
+    /**@brief
+     * Get number of samples, which did not match the decoded state (bounces or noise)
+     *
+     * @returns Number of corrected samples
+     */
+    unsigned long getCorrectedCount()
+    {
+      return m_corrected;
+    }
+
+    /**@brief
+     * Get number of decoded transitions over two states (missed samples)
+     *
+     * @returns Number of skipped states
+     */
+    unsigned long getSkippedCount()
+    {
+      return m_skipped;
+    }
+
+    /**@brief
+     * Get number of steps, which did not fit into the event arrays (Free running counter, use the difference between two calls)
+     *
+     * @returns Number of decoded steps, which were not reported by decode() or decodeArrays()
+     */
+    unsigned long getUnreportedCount()
+    {
+      return m_unreported;
+    }
+  private:
+    // Stores steps in an array of KY040BatchEvent
+    struct eventWriter {
+      KY040BatchEvent *events;
+      size_t maxEvents;
+      size_t found;
+      size_t unreported; // Steps after the array was full
+
+      void add(size_t sample, signed char step, byte confidence)
+      {
+        if (found >= maxEvents) {
+          unreported++;
+          return;
+        }
+        events[found].sample = sample;
+        events[found].direction = (step > 0) ? KY040Directions::CLOCKWISE : KY040Directions::COUNTERCLOCKWISE;
+        events[found].confidence = confidence;
+        found++;
+      }
+    };
+
+    // Stores steps in separate arrays for each field
+    struct arrayWriter {
+      size_t *samples;
+      signed char *steps;
+      byte *confidences;
+      size_t maxEvents;
+      size_t found;
+      size_t unreported; // Steps after the arrays were full
+
+      void add(size_t sample, signed char step, byte confidence)
+      {
+        if (found >= maxEvents) {
+          unreported++;
+          return;
+        }
+        samples[found] = sample;
+        steps[found] = step;
+        confidences[found] = confidence;
+        found++;
+      }
+    };
+
+    // Decodes the samples and reports the steps to the writer
+    template <class WRITER>
+    void run(const byte samples[], size_t count, byte work[], WRITER &writer)
+    {
+      if (count == 0) return;
+
+      // Forward pass: Costs of the best path to each phase and back pointers (2 bits for each phase)
+      unsigned int cost[4];
+      for (byte p=0;p<4;p++) cost[p] = (p == m_phase) ? 0 : 0x7FFF;
+      for (size_t i=0;i<count;i++) {
+        byte sample = samples[i] & 0b11;
+        unsigned int newCost[4];
+        byte backPointers = 0;
+        unsigned int minCost = 0xFFFF;
+        for (byte p=0;p<4;p++) {
+          // Best previous phase: same, neighbours or two states away
+          byte best = p;
+          unsigned int bestCost = cost[p];
+          unsigned int c = cost[(p+1)&3] + m_model.step;
+          if (c < bestCost) { bestCost = c; best = (p+1)&3; }
+          c = cost[(p+3)&3] + m_model.step;
+          if (c < bestCost) { bestCost = c; best = (p+3)&3; }
+          c = cost[(p+2)&3] + m_model.skip;
+          if (c < bestCost) { bestCost = c; best = (p+2)&3; }
+          byte difference = sample ^ c_batchStateOfPhase[p];
+          if (difference == 0b11) bestCost += m_model.twoBits; else if (difference != 0) bestCost += m_model.oneBit;
+          newCost[p] = bestCost;
+          backPointers |= best << (2*p);
+          if (bestCost < minCost) minCost = bestCost;
+        }
+        for (byte p=0;p<4;p++) cost[p] = newCost[p] - minCost; // Normalize to prevent overruns
+        work[i] = backPointers;
+      }
+
+      // Traceback: Replace back pointers with the decoded phases
+      byte phase = 0;
+      for (byte p=1;p<4;p++) if (cost[p] < cost[phase]) phase = p;
+      for (size_t i=count-1;i>0;i--) {
+        byte previous = (work[i] >> (2*phase)) & 0b11;
+        work[i] = phase;
+        phase = previous;
+      }
+      work[0] = phase;
+
+      // Find steps like checkRotation(): Four states in one direction from and back to the idle state
+      byte lastPhase = m_phase;
+      for (size_t i=0;i<count;i++) {
+        phase = work[i];
+        switch ((phase - lastPhase) & 0b11) {
+          case 1:
+            m_offset++;
+            m_lastStep = 1;
+            break;
+          case 3:
+            m_offset--;
+            m_lastStep = -1;
+            break;
+          case 2: // Missed sample, assume the last direction
+            m_offset += 2*m_lastStep;
+            m_skipped++;
+            break;
+        }
+        lastPhase = phase;
+        if ((samples[i] & 0b11) != c_batchStateOfPhase[phase]) m_corrected++;
+        if (m_offset == 0) { // Idle, confidence is only calculated from samples of a running sequence
+          m_matches = 0;
+          m_samples = 0;
+          continue;
+        }
+        m_samples++;
+        if ((samples[i] & 0b11) == c_batchStateOfPhase[phase]) m_matches++;
+        if ((m_offset >= 4) || (m_offset <= -4)) {
+          writer.add(i, (m_offset > 0) ? 1 : -1, (255UL * m_matches) / m_samples);
+          m_position += (m_offset > 0) ? 1 : -1;
+          m_offset += (m_offset > 0) ? -4 : 4;
+          m_matches = 0;
+          m_samples = 0;
+        }
+      }
+      m_phase = lastPhase;
+    }
+
+    KY040BatchModel m_model;
+    byte m_phase; // Decoded phase of the last sample
+    signed char m_offset; // Phases moved since the idle state
+    signed char m_lastStep;
+    long m_position;
+    unsigned long m_matches; // Matching samples in the running sequence
+    unsigned long m_samples; // Samples in the running sequence
+    unsigned long m_corrected;
+    unsigned long m_skipped;
+    unsigned long m_unreported; // Steps, which did not fit into the event arrays
+};
@@ -0,0 +1,137 @@
+/**
+ * Class: KY040Clock
+ *
+ * Description:
+ * Clock prescaler control with compensated time for KY040 rotary
+ * encoders on AVR. With a clock prescaler of 2^N the MCU runs for example with
+ * 1 MHz instead of 16 MHz and needs less power, but Timer0 runs slower too and
+ * millis() does not count milliseconds anymore. KY040Clock counts the time
+ * since the last prescaler change and multiplies it with the active division
+ * factor. With KY040_USE_CLOCK, KY040.h sets KY040_MILLIS() to
+ * KY040Clock::getMillis() and KY040_MICROS() to KY040Clock::getMicros(), so
+ * the PREVENTSLEEPMS logic and all timestamps of the library stay correct.
+ * Including this file defines KY040_USE_CLOCK. The time source is part of the
+ * inline code of KY040, so it must be the same in all translation units:
+ * define KY040_USE_CLOCK for the whole build or include KY040Clock.h before
+ * KY040.h in every file. Including this file after KY040.h without
+ * KY040_USE_CLOCK is an error.
+ *
+ * The prescaler is set with clock_prescale_set() of avr-libc. The resolution
+ * of the compensated time drops to 2^N milliseconds. Peripherals with clock
+ * dependent timings (for example Serial) only work with the full clock. See
+ * KY040ClockPolicy.h for a policy, which downclocks while idle.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Clock.h
+ */
+#pragma once
+
+#if defined(KY040_VERSION) && !defined(KY040_USE_CLOCK)
+#error "KY040.h already uses millis()/micros(). Include KY040Clock.h before KY040.h or define KY040_USE_CLOCK"
+#endif
+
+#ifndef KY040_USE_CLOCK
+/** Lets KY040.h use the compensated time */
+#define KY040_USE_CLOCK
+#endif
+
+#include <arduino.h>
+#include <avr/power.h>
+
+/** Clock prescaler control with compensated time (AVR only) */
+class KY040Clock {
+  public:
+    /**@brief
+     * Sets the clock prescaler. Can be used inside ISR.
+     *
+     * @param[in] prescaler Division factor 2^prescaler (0 = full clock ... 8 = clock/256)
+     */
+    static void setPrescaler(byte prescaler)
+    {
+      clockData &clock = data();
+      byte oldSREG = SREG;
+      cli();
+      unsigned long rawMillis = millis();
+      unsigned long rawMicros = micros();
+      clock.baseMillis += (rawMillis - clock.rawMillis) << clock.prescaler;
+      clock.baseMicros += (rawMicros - clock.rawMicros) << clock.prescaler;
+      clock.rawMillis = rawMillis;
+      clock.rawMicros = rawMicros;
+      clock.prescaler = prescaler;
+      clock_prescale_set((clock_div_t) prescaler);
+      SREG = oldSREG;
+    }
+
+    /**@brief
+     * Get clock prescaler. Can be used inside ISR.
+     *
+     * @returns Prescaler for the division factor 2^prescaler
+     */
+    static byte getPrescaler()
+    {
+      return data().prescaler;
+    }
+
+    /**@brief
+     * Get compensated milliseconds since start. Can be used inside ISR.
+     *
+     * @returns Milliseconds like millis() with the full clock
+     */
+    static unsigned long getMillis()
+    {
+      clockData &clock = data();
+      byte oldSREG = SREG;
+      cli();
+      unsigned long result = clock.baseMillis + ((millis() - clock.rawMillis) << clock.prescaler);
+      SREG = oldSREG;
+      return result;
+    }
+
+    /**@brief
+     * Get compensated microseconds since start. Can be used inside ISR.
+     *
+     * @returns Microseconds like micros() with the full clock
+     */
+    static unsigned long getMicros()
+    {
+      clockData &clock = data();
+      byte oldSREG = SREG;
+      cli();
+      unsigned long result = clock.baseMicros + ((micros() - clock.rawMicros) << clock.prescaler);
+      SREG = oldSREG;
+      return result;
+    }
+  private:
+    struct clockData {
+      unsigned long baseMillis; // Compensated time at the last prescaler change
+      unsigned long baseMicros;
+      unsigned long rawMillis; // millis() at the last prescaler change
+      unsigned long rawMicros;
+      volatile byte prescaler; // Changed inside ISR by KY040ClockPolicy::wakeup()
+    };
+
+    // One clock for all translation units
+    static clockData &data()
+    {
+      static clockData s_data = {0,0,0,0,0};
+      return s_data;
+    }
+};
+
+#ifndef KY040_MILLIS
+/** Compensated time source for the library */
+#define KY040_MILLIS() KY040Clock::getMillis()
+#endif
+#ifndef KY040_MICROS
+/** Compensated time source for the step timestamps */
+#define KY040_MICROS() KY040Clock::getMicros()
+#endif
+
+#include "KY040.h"
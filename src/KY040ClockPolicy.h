@@ -0,0 +1,93 @@
+/**
+ * Class: KY040ClockPolicy
+ *
+ * Description:
+ * Policy for KY040Clock to downclock, when all rotary encoders are idle, and
+ * to restore the full clock on the first CLK/DT edge. checkRotation() needs
+ * about 16 times longer at 1 MHz (some 10 microseconds), which is still much
+ * less than the time between two edges of a turned rotary encoder.
+ * KY040.h includes this file with KY040_USE_CLOCK (see KY040Clock.h).
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040ClockPolicy.h
+ */
+#pragma once
+
+#include "KY040Clock.h"
+
+/** Policy to downclock, when all rotary encoders are idle, and to restore the full clock on the first edge */
+class KY040ClockPolicy {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoders Array of rotary encoders
+     * @param[in] count Number of rotary encoders in the array
+     * @param[in] idlePrescaler Clock prescaler while idle (for example 4 = 1 MHz on a 16 MHz board)
+     */
+    KY040ClockPolicy(KY040 *encoders[], byte count, byte idlePrescaler)
+    {
+      m_encoders = encoders;
+      m_count = count;
+      m_idlePrescaler = idlePrescaler;
+      m_downclocks = 0;
+    }
+
+    /**@brief
+     * Downclocks, when all rotary encoders are ready for sleep and between two steps. Call it in your loop after clock dependent work, for example after Serial.flush() (Do not use inside ISR)
+     *
+     * @retval true MCU runs with the idle prescaler
+     * @retval false MCU runs with the full clock
+     */
+    bool update()
+    {
+      // Decide with disabled interrupts, because wakeup() for an edge between the check and the change would be undone
+      cli();
+      bool result = true;
+      if (KY040Clock::getPrescaler() != m_idlePrescaler) {
+        unsigned long currentMillis = KY040_MILLIS();
+        for (byte i=0;i<m_count;i++) {
+          if (!m_encoders[i]->readyForDeepSleep(currentMillis)) {
+            result = false;
+            break;
+          }
+        }
+        if (result) {
+          KY040Clock::setPrescaler(m_idlePrescaler);
+          m_downclocks++;
+        }
+      }
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Restores the full clock. Call it in your ISR before checkRotation().
+     */
+    void wakeup()
+    {
+      if (KY040Clock::getPrescaler() != 0) KY040Clock::setPrescaler(0);
+    }
+
+    /**@brief
+     * Get number of downclocks (Free running counter)
+     *
+     * @returns Number of changes to the idle prescaler
+     */
+    unsigned long getDownclockCount()
+    {
+      return m_downclocks;
+    }
+  private:
+    KY040 **m_encoders;
+    byte m_count;
+    byte m_idlePrescaler;
+    unsigned long m_downclocks;
+};
@@ -0,0 +1,43 @@
+/**
+ * Class: KY040Directions
+ *
+ * Description:
+ * Rotation states and the idle CLK/DT state, which are shared by KY040 and
+ * the decoders, which also work without a KY040 object. Without Arduino
+ * (ARDUINO not defined) the header only needs the C++ standard headers, so
+ * for example KY040Batch can decode captured traces on a PC.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Directions.h
+ */
+#pragma once
+
+#if defined(ARDUINO)
+#include <arduino.h>
+#else
+#include <stdint.h>
+typedef uint8_t byte;
+#endif
+
+// Pin idle state
+#define INITSTEP 0b11
+
+/** Rotation states (base class of KY040, so they can be used as KY040::CLOCKWISE, ...) */
+class KY040Directions {
+  public:
+      /** Rotation states */
+    enum directions 
+    { 
+      IDLE, /**< Rotary encoder is idle */
+      ACTIVE, /**< Rotary encoder is rotating, but the CLK/DT sequence has not finished */
+      CLOCKWISE, /**< CLK/DT sequence for one step clockwise rotation has finished */
+      COUNTERCLOCKWISE /**< CLK/DT sequence for one step counter-clockwise rotation has finished */
+    };
+};
@@ -0,0 +1,290 @@
+/**
+ * Class: KY040Generator
+ *
+ * Description:
+ * Quadrature output generator, which emits the CLK/DT sequences of a KY-040
+ * rotary encoder on two output pins, for example to drive equipment expecting
+ * an encoder input or to test a decoder without hardware (loopback to a KY040
+ * object). tick() is called from a timer ISR with a fixed period, writes at
+ * most one edge per call and follows a target position with a maximum step
+ * rate. The edges of a step are evenly spaced, and a started step is always
+ * finished, like on a real rotary encoder.
+ *
+ * Bounces can be injected: after an edge, the changed pin is toggled back and
+ * forth for a number of ticks and ends at its new level. Bounce ticks are
+ * part of the time between two edges, so they do not change the step rate as
+ * long as the time between two edges is longer than the bounces.
+ *
+ * The sequences are the same tables c_signalSequenceCW/c_signalSequenceCCW,
+ * which KY040 uses for decoding.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Generator.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Class for a timer driven KY-040 quadrature output generator */
+class KY040Generator {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] pinCLK Digital output pin for CLK aka. A
+     * @param[in] pinDT Digital output pin for DT aka. B
+     * @param[in] tickMicros Period in microseconds of the timer ISR calling tick()
+     */
+    KY040Generator(byte pinCLK, byte pinDT, unsigned long tickMicros)
+    {
+      m_pinCLK = pinCLK;
+      m_pinDT = pinDT;
+      m_tickMicros = tickMicros;
+      m_state = INITSTEP;
+      v_position = 0;
+      v_target = 0;
+      v_sequenceStep = 0;
+      v_direction = KY040::IDLE;
+      v_ticksPerEdge = 1;
+      v_wait = 0;
+      v_bounces = 0;
+      v_bouncePercent = 0;
+      v_bounceRemaining = 0;
+      v_bounceMask = 0;
+      m_random = 0x2545F491;
+      #if defined(__AVR__)
+      m_clkOutputRegister = NULL;
+      m_dtOutputRegister = NULL;
+      #endif
+    }
+
+    /**@brief
+     * Sets the pins to output and writes the idle state (CLK and DT high). Call it in setup() before starting the timer.
+     *
+     * On AVR the output registers for CLK and DT are cached, so tick() writes the pins without digitalWrite().
+     */
+    void begin()
+    {
+      #if defined(__AVR__)
+      m_clkOutputRegister = portOutputRegister(digitalPinToPort(m_pinCLK));
+      m_clkBitMask = digitalPinToBitMask(m_pinCLK);
+      m_dtOutputRegister = portOutputRegister(digitalPinToPort(m_pinDT));
+      m_dtBitMask = digitalPinToBitMask(m_pinDT);
+      #endif
+      m_state = INITSTEP;
+      writeState(m_state);
+      pinMode(m_pinCLK, OUTPUT);
+      pinMode(m_pinDT, OUTPUT);
+    }
+
+    /**@brief
+     * Writes the next edge or bounce. Call it from your timer ISR.
+     */
+    void tick()
+    {
+      if (v_bounceRemaining > 0) { // Toggle the pin of the last edge
+        v_bounceRemaining--;
+        m_state ^= v_bounceMask;
+        writeState(m_state);
+        return;
+      }
+      if (v_wait > 0) {
+        v_wait--;
+        return;
+      }
+      byte sequenceStep = v_sequenceStep;
+      byte direction = v_direction;
+      if (sequenceStep == 0) { // Idle, check for the next step
+        if (v_position == v_target) return;
+        direction = (v_target > v_position) ? KY040::CLOCKWISE : KY040::COUNTERCLOCKWISE;
+      }
+      const byte *sequence = (direction == KY040::CLOCKWISE) ? c_signalSequenceCW : c_signalSequenceCCW;
+      byte state = sequence[sequenceStep];
+      byte changed = m_state ^ state;
+      m_state = state;
+      writeState(state);
+      sequenceStep++;
+      if (sequenceStep >= MAXSEQUENCESTEPS) { // Step has finished
+        v_position += (direction == KY040::CLOCKWISE) ? 1 : -1;
+        direction = KY040::IDLE;
+        sequenceStep = 0;
+      }
+      v_sequenceStep = sequenceStep;
+      v_direction = direction;
+
+      unsigned int wait = v_ticksPerEdge - 1;
+      if ((v_bounces > 0) && (nextRandom() % 100 < v_bouncePercent)) {
+        // An even number of toggles ends at the new level
+        unsigned int toggles = 2 * v_bounces;
+        v_bounceMask = changed;
+        v_bounceRemaining = toggles;
+        wait = (wait > toggles) ? wait - toggles : 0;
+      }
+      v_wait = wait;
+    }
+
+    /**@brief
+     * Sets the target position. The generator emits steps until its position has reached the target. (Do not use inside ISR)
+     *
+     * @param[in] target Target position
+     */
+    void setTarget(int target)
+    {
+      cli();
+      v_target = target;
+      sei();
+    }
+
+    /**@brief
+     * Get target position (Do not use inside ISR)
+     *
+     * @returns Target position
+     */
+    int getTarget()
+    {
+      cli();
+      int result = v_target;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get position after the last finished step (Do not use inside ISR)
+     *
+     * @returns Position
+     */
+    int getPosition()
+    {
+      cli();
+      int result = v_position;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Sets position and target without emitting steps, for example to synchronize with a decoder (Do not use inside ISR)
+     *
+     * @param[in] position New position
+     */
+    void setPosition(int position)
+    {
+      cli();
+      v_position = position;
+      v_target = position;
+      sei();
+    }
+
+    /**@brief
+     * Checks, if the target is reached and no step is running (Do not use inside ISR)
+     *
+     * @retval true Position is the target and the pins are idle
+     * @retval false Steps are emitted
+     */
+    bool isIdle()
+    {
+      cli();
+      bool result = (v_position == v_target) && (v_sequenceStep == 0) && (v_bounceRemaining == 0);
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Sets the maximum step rate (Do not use inside ISR)
+     *
+     * The time between two edges is rounded up to full ticks, so the step rate can be lower than the maximum.
+     *
+     * @param[in] stepsPerSecond Maximum steps per second (0 = one edge for each tick)
+     */
+    void setMaxStepRate(unsigned int stepsPerSecond)
+    {
+      unsigned int ticksPerEdge = 1;
+      if ((stepsPerSecond > 0) && (m_tickMicros > 0)) {
+        unsigned long microsPerEdge = (1000000UL + 4UL * stepsPerSecond - 1) / (4UL * stepsPerSecond);
+        unsigned long ticks = (microsPerEdge + m_tickMicros - 1) / m_tickMicros;
+        ticksPerEdge = (ticks > 0xFFFF) ? 0xFFFF : ((ticks < 1) ? 1 : ticks);
+      }
+      cli();
+      v_ticksPerEdge = ticksPerEdge;
+      sei();
+    }
+
+    /**@brief
+     * Get step rate, which is emitted with the current maximum step rate (Do not use inside ISR)
+     *
+     * @returns Steps per second
+     */
+    unsigned long getStepRate()
+    {
+      cli();
+      unsigned int ticksPerEdge = v_ticksPerEdge;
+      sei();
+      if (m_tickMicros == 0) return 0;
+      return 1000000UL / (4UL * ticksPerEdge * m_tickMicros);
+    }
+
+    /**@brief
+     * Injects bounces after edges (Do not use inside ISR)
+     *
+     * @param[in] bounces Number of bounces (each bounce toggles the changed pin twice, one toggle for each tick. 0 = no bounces)
+     * @param[in] percent Probability 0..100 for bounces after an edge
+     */
+    void setBounce(byte bounces, byte percent)
+    {
+      cli();
+      v_bounces = bounces;
+      v_bouncePercent = percent;
+      sei();
+    }
+  private:
+    // Writes the CLK/DT state (left bit is for CLK, right bit is for DT)
+    void writeState(byte state)
+    {
+      #if defined(__AVR__)
+      if (m_clkOutputRegister != NULL) {
+        if (state & 0b10) *m_clkOutputRegister |= m_clkBitMask; else *m_clkOutputRegister &= ~m_clkBitMask;
+        if (state & 0b01) *m_dtOutputRegister |= m_dtBitMask; else *m_dtOutputRegister &= ~m_dtBitMask;
+        return;
+      }
+      #endif
+      digitalWrite(m_pinCLK, (state & 0b10) ? HIGH : LOW);
+      digitalWrite(m_pinDT, (state & 0b01) ? HIGH : LOW);
+    }
+
+    // Pseudo random numbers for the bounces (xorshift, called from ISR)
+    byte nextRandom()
+    {
+      m_random ^= m_random << 13;
+      m_random ^= m_random >> 17;
+      m_random ^= m_random << 5;
+      return m_random & 0xFF;
+    }
+
+    byte m_pinCLK;
+    byte m_pinDT;
+    unsigned long m_tickMicros;
+    byte m_state; // Current CLK/DT output state, only changed by tick()
+    volatile int v_position;
+    volatile int v_target;
+    volatile byte v_sequenceStep;
+    volatile byte v_direction;
+    volatile unsigned int v_ticksPerEdge;
+    volatile unsigned int v_wait; // Remaining ticks until the next edge
+    volatile byte v_bounces;
+    volatile byte v_bouncePercent;
+    volatile unsigned int v_bounceRemaining; // Remaining toggles of the current bounce
+    volatile byte v_bounceMask; // Pin of the last edge (0b10 = CLK, 0b01 = DT)
+    uint32_t m_random;
+    #if defined(__AVR__)
+    volatile byte *m_clkOutputRegister; // Cached by begin()
+    volatile byte *m_dtOutputRegister; // Cached by begin()
+    byte m_clkBitMask;
+    byte m_dtBitMask;
+    #endif
+};
@@ -0,0 +1,164 @@
+/**
+ * Class: KY040GrayCode
+ *
+ * Description:
+ * Class for absolute rotary switches with an N-bit Gray code output (for
+ * example 4-bit selectors with 16 positions). It uses the same idea as KY040:
+ * Instead of timing based debouncing only valid transitions are accepted.
+ * Only codes of a neighbour position of the last accepted code are accepted at
+ * once. In a Gray code two neighbour positions differ in exactly one bit, but
+ * not every single bit change is a neighbour (for example with 4 bits 0000 is
+ * position 0 and 0100 is position 7), so the decoded positions are compared.
+ *
+ * Like KY040 the class works with or without interrupts: Store the raw port
+ * value with setState() (for example in the same pin change ISR as your KY040
+ * rotary encoders) and process it with checkPosition().
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040GrayCode.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Number of equal samples of a code, which is not a neighbour position of the last accepted code, to accept it anyway (for example after missed positions) */
+#define KY040GRAYRESYNCSAMPLES 3
+
+/** Class for absolute Gray code rotary switches */
+class KY040GrayCode {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] bits Number of code bits (1..8)
+     * @param[in] shift Position of the lowest code bit in the raw port value
+     * @param[in] inverted true, when the switch connects to ground (with pull up resistors a closed contact reads as 0)
+     */
+    KY040GrayCode(byte bits, byte shift, bool inverted = true)
+    {
+      m_mask = (bits >= 8) ? 0xFF : ((1 << bits) - 1);
+      m_shift = shift;
+      m_invert = inverted ? m_mask : 0;
+      v_state = 0;
+      v_code = 0;
+      v_position = 0;
+      v_candidate = 0;
+      v_candidateCount = 0;
+      v_rejectedCount = 0;
+    }
+
+    /**@brief
+     * Accepts the code of a raw port value without checks. Call it in setup().
+     *
+     * @param[in] raw Raw port value, for example PIND
+     */
+    void begin(byte raw)
+    {
+      byte code = toCode(raw);
+      cli();
+      v_state = raw;
+      v_code = code;
+      v_position = toPosition(code);
+      v_candidateCount = 0;
+      sei();
+    }
+
+    /**@brief
+     * Stores the raw port value. Should be called from ISR, when needed.
+     *
+     * @param[in] raw Raw port value, for example PIND
+     */
+    void setState(byte raw)
+    {
+      v_state = raw;
+    }
+
+    /**@brief
+     * Checks the stored raw port value and accepts it, when its position is a neighbour of the last accepted position
+     *
+     * @retval KY040::CLOCKWISE        Position has increased by one (with overrun from the last to the first position)
+     * @retval KY040::COUNTERCLOCKWISE Position has decreased by one (with overrun from the first to the last position)
+     * @retval KY040::IDLE             Position is unchanged
+     */
+    byte checkPosition()
+    {
+      byte code = toCode(v_state);
+      byte acceptedCode = v_code;
+      if (code == acceptedCode) {
+        v_candidateCount = 0;
+        return KY040::IDLE;
+      }
+      byte oldPosition = v_position;
+      byte position = toPosition(code);
+      if ((position != ((oldPosition + 1) & m_mask)) && (oldPosition != ((position + 1) & m_mask))) { // No neighbour position
+        v_rejectedCount++;
+        // Resync, when the code is stable
+        if (code != v_candidate) {
+          v_candidate = code;
+          v_candidateCount = 1;
+          return KY040::IDLE;
+        }
+        if (++v_candidateCount < KY040GRAYRESYNCSAMPLES) return KY040::IDLE;
+      }
+      v_candidateCount = 0;
+      v_code = code;
+      v_position = position;
+      if (position == ((oldPosition + 1) & m_mask)) return KY040::CLOCKWISE;
+      if (oldPosition == ((position + 1) & m_mask)) return KY040::COUNTERCLOCKWISE;
+      return KY040::IDLE; // Resync over more than one position
+    }
+
+    /**@brief
+     * Get accepted position (Do not use inside ISR)
+     *
+     * @returns Position 0..2^bits-1
+     */
+    byte getPosition()
+    {
+      return v_position;
+    }
+
+    /**@brief
+     * Get number of rejected codes (Free running counter. Do not use inside ISR)
+     *
+     * @returns Number of codes, which were not a neighbour position of the accepted code
+     */
+    unsigned int getRejectedCount()
+    {
+      cli();
+      unsigned int result = v_rejectedCount;
+      sei();
+      return result;
+    }
+  private:
+    byte toCode(byte raw)
+    {
+      return ((raw >> m_shift) & m_mask) ^ m_invert;
+    }
+
+    // Gray code to binary position
+    static byte toPosition(byte code)
+    {
+      code ^= code >> 4;
+      code ^= code >> 2;
+      code ^= code >> 1;
+      return code;
+    }
+
+    byte m_mask;
+    byte m_shift;
+    byte m_invert;
+    volatile byte v_state;
+    volatile byte v_code; // Last accepted code
+    volatile byte v_position; // Position of the last accepted code
+    volatile byte v_candidate; // Code, which is not a neighbour position, but could be accepted by a resync
+    volatile byte v_candidateCount;
+    volatile unsigned int v_rejectedCount;
+};
@@ -0,0 +1,149 @@
+/**
+ * Class: KY040Histogram
+ *
+ * Description:
+ * Latency histogram with logarithmic buckets, for example for the time in
+ * microseconds from a CLK/DT edge to the decoded step. Bucket 0 counts the
+ * value 0, bucket i counts the values 2^(i-1) ... 2^i-1 and the last bucket
+ * counts all larger values. Recording needs no multiplications or divisions,
+ * so it can be used inside ISR.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Histogram.h
+ */
+#pragma once
+
+#include <arduino.h>
+
+/** Number of buckets (the last bucket counts values from 2^(KY040HISTOGRAMBUCKETS-2)) */
+#define KY040HISTOGRAMBUCKETS 16
+
+/** Class for latency histograms with logarithmic buckets */
+class KY040Histogram {
+  public:
+    /**@brief
+     * Constructor
+     */
+    KY040Histogram()
+    {
+      reset();
+    }
+
+    /**@brief
+     * Records a value. Can be used inside ISR.
+     *
+     * @param[in] value Value, for example a latency in microseconds
+     */
+    void record(unsigned long value)
+    {
+      byte bucket = 0;
+      unsigned long remaining = value;
+      while ((remaining != 0) && (bucket < KY040HISTOGRAMBUCKETS-1)) {
+        remaining >>= 1;
+        bucket++;
+      }
+      v_counts[bucket]++;
+      v_total++;
+      if (value > v_max) v_max = value;
+    }
+
+    /**@brief
+     * Clears all buckets (Do not use inside ISR)
+     */
+    void reset()
+    {
+      cli();
+      for (byte i=0;i<KY040HISTOGRAMBUCKETS;i++) v_counts[i] = 0;
+      v_total = 0;
+      v_max = 0;
+      sei();
+    }
+
+    /**@brief
+     * Get number of values in a bucket (Do not use inside ISR)
+     *
+     * @param[in] bucket Bucket 0..KY040HISTOGRAMBUCKETS-1
+     *
+     * @returns Number of values
+     */
+    unsigned long getCount(byte bucket)
+    {
+      cli();
+      unsigned long result = v_counts[bucket];
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get largest value of a bucket
+     *
+     * @param[in] bucket Bucket 0..KY040HISTOGRAMBUCKETS-1
+     *
+     * @returns Largest value counted in the bucket (0xFFFFFFFF for the last bucket)
+     */
+    static unsigned long getBucketLimit(byte bucket)
+    {
+      if (bucket >= KY040HISTOGRAMBUCKETS-1) return 0xFFFFFFFF;
+      return (1UL << bucket) - 1;
+    }
+
+    /**@brief
+     * Get number of all recorded values (Do not use inside ISR)
+     *
+     * @returns Number of values
+     */
+    unsigned long getTotal()
+    {
+      cli();
+      unsigned long result = v_total;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get largest recorded value (Do not use inside ISR)
+     *
+     * @returns Largest value
+     */
+    unsigned long getMax()
+    {
+      cli();
+      unsigned long result = v_max;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get upper limit of a percentile (Do not use inside ISR)
+     *
+     * @param[in] percent Percentile 1..100, for example 99
+     *
+     * @returns Largest value of the bucket, which contains the percentile (the largest recorded value for the last bucket, 0 without values)
+     */
+    unsigned long getPercentile(byte percent)
+    {
+      cli();
+      unsigned long total = v_total;
+      unsigned long max = v_max;
+      sei();
+      if (total == 0) return 0;
+      unsigned long needed = (total * percent + 99) / 100;
+      unsigned long sum = 0;
+      for (byte i=0;i<KY040HISTOGRAMBUCKETS;i++) {
+        sum += getCount(i);
+        if (sum >= needed) return (getBucketLimit(i) < max) ? getBucketLimit(i) : max;
+      }
+      return max;
+    }
+  private:
+    volatile unsigned long v_counts[KY040HISTOGRAMBUCKETS];
+    volatile unsigned long v_total;
+    volatile unsigned long v_max;
+};
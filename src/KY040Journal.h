@@ -0,0 +1,329 @@
+/**
+ * Class: KY040Journal
+ *
+ * Description:
+ * Journal for KY040 rotary encoder steps on a block device (for example a SD
+ * card or SPI flash). Each step is stored with a timestamp, the index of the
+ * rotary encoder and the new position. Writing each step with a small file
+ * write stalls the loop for milliseconds, so steps are collected in a double
+ * buffer of 512 byte blocks. add() can be called from ISR and only copies 8
+ * bytes. update() writes a full block or, after a timeout, a partially filled
+ * block in the loop, while add() fills the other buffer.
+ *
+ * The journal is a ring of blocks on the device. Each block has a header with
+ * a magic, a sequence number, the number of steps and a CRC-16 (CCITT) over
+ * the whole block. A block torn by a power loss has a wrong CRC, so begin()
+ * finds the last completely written block by its sequence number and
+ * continues after it (crash recovery).
+ *
+ * @code
+ * Block:  'K' 'Y' 'J' '1' sequence(4) count(2) crc(2) step[0] ... step[61]
+ * Step:   millis(4) position(2) index(1) direction(1)
+ * @endcode
+ * Multi byte values are little endian.
+ *
+ * The block device is a template parameter with the methods
+ * bool readBlock(unsigned long block, byte *data) and
+ * bool writeBlock(unsigned long block, const byte *data) for 512 bytes, for
+ * example Sd2Card of the Arduino SD library or a file based class on a PC.
+ * The double buffer needs 1 KB RAM.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Journal.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Size of a journal block in bytes */
+#define KY040JOURNALBLOCKSIZE 512
+/** Size of the block header in bytes */
+#define KY040JOURNALHEADERSIZE 12
+/** Size of a step in bytes */
+#define KY040JOURNALSTEPSIZE 8
+/** Number of steps in a block */
+#define KY040JOURNALSTEPS ((KY040JOURNALBLOCKSIZE - KY040JOURNALHEADERSIZE) / KY040JOURNALSTEPSIZE)
+
+/** Step read from a journal block */
+struct KY040JournalStep {
+  unsigned long millis; /**< Time of the step */
+  int position; /**< Position after the step */
+  byte index; /**< Index of the rotary encoder */
+  byte direction; /**< KY040::CLOCKWISE or KY040::COUNTERCLOCKWISE */
+};
+
+/**
+ * Journal for KY-040 rotary encoder steps on a block device
+ *
+ * @tparam BLOCKDEVICE Class with readBlock() and writeBlock() for 512 byte blocks, for example Sd2Card
+ */
+template <class BLOCKDEVICE>
+class KY040Journal {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] device Block device
+     * @param[in] firstBlock First block of the journal on the device
+     * @param[in] blocks Number of blocks of the journal (ring, 0 is used as 1)
+     * @param[in] flushMillis Time in milliseconds after the first step of a block to write a partially filled block
+     */
+    KY040Journal(BLOCKDEVICE &device, unsigned long firstBlock, unsigned long blocks, unsigned long flushMillis)
+    {
+      m_device = &device;
+      m_firstBlock = firstBlock;
+      m_blocks = (blocks == 0) ? 1 : blocks; // Prevent division by zero in begin() and update()
+      m_flushMillis = flushMillis;
+      m_nextBlock = 0;
+      m_sequence = 0;
+      v_active = 0;
+      v_count = 0;
+      v_pending[0] = v_pending[1] = false;
+      v_pendingCount[0] = v_pendingCount[1] = 0;
+      v_firstStepMillis = 0;
+      v_dropped = 0;
+      m_writeErrors = 0;
+      m_writtenBlocks = 0;
+    }
+
+    /**@brief
+     * Finds the last completely written block and continues after it. Call it in setup() after initializing the device.
+     *
+     * Reads all blocks of the journal.
+     *
+     * @retval true Success
+     * @retval false A block could not be read
+     */
+    bool begin()
+    {
+      byte *block = m_buffers[0];
+      bool found = false;
+      unsigned long lastSequence = 0;
+      unsigned long lastBlock = 0;
+      for (unsigned long i=0;i<m_blocks;i++) {
+        if (!m_device->readBlock(m_firstBlock + i, block)) return false;
+        if (!isValid(block)) continue;
+        unsigned long sequence = getLong(&block[4]);
+        // Sequence numbers are compared by difference, so an overrun of the sequence number is no problem
+        if (!found || ((long) (sequence - lastSequence) > 0)) {
+          lastSequence = sequence;
+          lastBlock = i;
+          found = true;
+        }
+      }
+      m_nextBlock = found ? (lastBlock + 1) % m_blocks : 0;
+      m_sequence = found ? lastSequence + 1 : 0;
+      cli();
+      v_active = 0;
+      v_count = 0;
+      v_pending[0] = v_pending[1] = false;
+      sei();
+      return true;
+    }
+
+    /**@brief
+     * Adds a step. Can be used inside ISR. Call it always from the same context (only from ISR or only from your loop).
+     *
+     * @param[in] index Index of the rotary encoder
+     * @param[in] position Position after the step
+     * @param[in] direction KY040::CLOCKWISE or KY040::COUNTERCLOCKWISE
+     *
+     * @retval true Step was added
+     * @retval false Both buffers are full (update() was not called often enough), the step was dropped
+     */
+    bool add(byte index, int position, byte direction)
+    {
+      unsigned long currentMillis = KY040_MILLIS();
+      if (v_count >= KY040JOURNALSTEPS) {
+        if (v_pending[v_active ^ 1]) {
+          v_dropped++;
+          return false;
+        }
+        seal();
+      }
+      if (v_count == 0) v_firstStepMillis = currentMillis;
+      byte *step = &m_buffers[v_active][KY040JOURNALHEADERSIZE + v_count * KY040JOURNALSTEPSIZE];
+      setLong(step, currentMillis);
+      step[4] = (unsigned int) position & 0xFF;
+      step[5] = (unsigned int) position >> 8;
+      step[6] = index;
+      step[7] = direction;
+      v_count++;
+      return true;
+    }
+
+    /**@brief
+     * Writes a full block or a partially filled block after the timeout. Call it in your loop. (Do not use inside ISR)
+     *
+     * @retval true Nothing to write or block was written
+     * @retval false Write error, the block is written again with the next call
+     */
+    bool update()
+    {
+      cli();
+      if (!v_pending[0] && !v_pending[1] && (v_count > 0)) {
+        // Full buffer without waiting for the next add(), partially filled buffer after the timeout
+        if ((v_count >= KY040JOURNALSTEPS) || (KY040_MILLIS() - v_firstStepMillis >= m_flushMillis)) seal();
+      }
+      byte buffer = v_pending[v_active ^ 1] ? v_active ^ 1 : 2;
+      unsigned int count = (buffer < 2) ? v_pendingCount[buffer] : 0;
+      sei();
+      if (buffer == 2) return true;
+
+      // The sealed buffer is not changed by add() until it is released
+      byte *block = m_buffers[buffer];
+      block[0] = 'K';
+      block[1] = 'Y';
+      block[2] = 'J';
+      block[3] = '1';
+      setLong(&block[4], m_sequence);
+      block[8] = count & 0xFF;
+      block[9] = count >> 8;
+      block[10] = 0;
+      block[11] = 0;
+      for (unsigned int i=KY040JOURNALHEADERSIZE + count * KY040JOURNALSTEPSIZE;i<KY040JOURNALBLOCKSIZE;i++) block[i] = 0;
+      unsigned int crc = crc16(block);
+      block[10] = crc & 0xFF;
+      block[11] = crc >> 8;
+      if (!m_device->writeBlock(m_firstBlock + m_nextBlock, block)) {
+        m_writeErrors++;
+        return false;
+      }
+      m_nextBlock = (m_nextBlock + 1) % m_blocks;
+      m_sequence++;
+      m_writtenBlocks++;
+      cli();
+      v_pending[buffer] = false;
+      sei();
+      return true;
+    }
+
+    /**@brief
+     * Get sequence number of the next block
+     *
+     * @returns Sequence number (after begin() the last found sequence number + 1)
+     */
+    unsigned long getSequence()
+    {
+      return m_sequence;
+    }
+
+    /**@brief
+     * Get number of written blocks
+     *
+     * @returns Number of blocks written by update()
+     */
+    unsigned long getWrittenBlockCount()
+    {
+      return m_writtenBlocks;
+    }
+
+    /**@brief
+     * Get number of write errors
+     *
+     * @returns Number of failed block writes
+     */
+    unsigned long getWriteErrorCount()
+    {
+      return m_writeErrors;
+    }
+
+    /**@brief
+     * Get number of dropped steps (Do not use inside ISR)
+     *
+     * @returns Number of steps, which did not fit into the double buffer
+     */
+    unsigned long getDroppedCount()
+    {
+      cli();
+      unsigned long result = v_dropped;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Reads the steps of a journal block, for example to replay a journal on a PC
+     *
+     * @param[in] block Block with KY040JOURNALBLOCKSIZE bytes
+     * @param[out] steps Array for at least KY040JOURNALSTEPS steps
+     * @param[out] sequence Sequence number of the block
+     *
+     * @returns Number of steps (0 for an empty, torn or foreign block)
+     */
+    static unsigned int getSteps(const byte block[], KY040JournalStep steps[], unsigned long &sequence)
+    {
+      if (!isValid(block)) return 0;
+      sequence = getLong(&block[4]);
+      unsigned int count = block[8] | (block[9] << 8);
+      for (unsigned int i=0;i<count;i++) {
+        const byte *step = &block[KY040JOURNALHEADERSIZE + i * KY040JOURNALSTEPSIZE];
+        steps[i].millis = getLong(step);
+        steps[i].position = (int16_t) (step[4] | (step[5] << 8));
+        steps[i].index = step[6];
+        steps[i].direction = step[7];
+      }
+      return count;
+    }
+  private:
+    // Marks the active buffer as ready to write and switches to the other buffer (called from add() or with disabled interrupts)
+    void seal()
+    {
+      v_pendingCount[v_active] = v_count;
+      v_pending[v_active] = true;
+      v_active ^= 1;
+      v_count = 0;
+    }
+
+    static bool isValid(const byte block[])
+    {
+      if ((block[0] != 'K') || (block[1] != 'Y') || (block[2] != 'J') || (block[3] != '1')) return false;
+      unsigned int count = block[8] | (block[9] << 8);
+      if (count > KY040JOURNALSTEPS) return false;
+      return crc16(block) == (unsigned int) (block[10] | (block[11] << 8));
+    }
+
+    // CRC-16 (CCITT) over the block with a zero CRC field
+    static unsigned int crc16(const byte block[])
+    {
+      unsigned int crc = 0xFFFF;
+      for (unsigned int i=0;i<KY040JOURNALBLOCKSIZE;i++) {
+        crc ^= (unsigned int) (((i == 10) || (i == 11)) ? 0 : block[i]) << 8;
+        for (byte j=0;j<8;j++) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        crc &= 0xFFFF;
+      }
+      return crc;
+    }
+
+    static unsigned long getLong(const byte *data)
+    {
+      return (unsigned long) data[0] | ((unsigned long) data[1] << 8) | ((unsigned long) data[2] << 16) | ((unsigned long) data[3] << 24);
+    }
+
+    static void setLong(byte *data, unsigned long value)
+    {
+      for (byte i=0;i<4;i++) data[i] = (value >> (8*i)) & 0xFF;
+    }
+
+    BLOCKDEVICE *m_device;
+    unsigned long m_firstBlock;
+    unsigned long m_blocks;
+    unsigned long m_flushMillis;
+    unsigned long m_nextBlock; // Block for the next write (relative to m_firstBlock)
+    unsigned long m_sequence; // Sequence number for the next write
+    byte m_buffers[2][KY040JOURNALBLOCKSIZE];
+    volatile byte v_active; // Buffer filled by add()
+    volatile unsigned int v_count; // Steps in the active buffer
+    volatile bool v_pending[2]; // Buffer is sealed and waits for update()
+    volatile unsigned int v_pendingCount[2];
+    volatile unsigned long v_firstStepMillis; // Time of the first step in the active buffer
+    volatile unsigned long v_dropped;
+    unsigned long m_writeErrors;
+    unsigned long m_writtenBlocks;
+};
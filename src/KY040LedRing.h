@@ -0,0 +1,179 @@
+/**
+ * Class: KY040LedRing
+ *
+ * Description:
+ * LED ring output for KY040 rotary encoders over a chain of 74HC595 shift
+ * registers. Each ring shows the position of its rotary encoder.
+ *
+ * update() only recalculates the pattern of rings with a changed position and
+ * only shifts out the chain, when at least one byte of the patterns has changed.
+ * Because a 74HC595 chain can only be written as a whole, a change shifts out
+ * all bytes with one latch pulse at the end.
+ *
+ * The bus is a template parameter, so the class works with the Arduino SPI
+ * object (SPIClass) or any class with a byte transfer(byte) method, for
+ * example a fake bus for tests. SPI.begin() and the SPI settings are up to
+ * your sketch.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040LedRing.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/**
+ * Class for LED rings on 74HC595 shift registers showing KY-040 rotary encoder positions
+ *
+ * @tparam BUS Class with a byte transfer(byte) method, for example SPIClass
+ * @tparam RINGS Number of LED rings
+ * @tparam LEDS Number of LEDs per ring (multiple of 8, for example 16 or 24)
+ */
+template <class BUS, byte RINGS, byte LEDS>
+class KY040LedRing {
+  static_assert((LEDS % 8 == 0) && (LEDS > 0), "LEDS must be a multiple of 8, because each ring uses whole 74HC595 bytes");
+  public:
+    /** Display modes */
+    enum modes
+    {
+      DOT, /**< One LED for the position between minimum and maximum */
+      BAR, /**< All LEDs from the first LED to the position between minimum and maximum */
+      WRAP /**< One LED for the position modulo LEDS (for endless rotation) */
+    };
+
+    /**@brief
+     * Constructor
+     *
+     * @param[in] bus Bus for the 74HC595 chain, for example SPI
+     * @param[in] latchPin Digital output pin connected to the latch pin (RCLK) of the 74HC595 chain
+     */
+    KY040LedRing(BUS &bus, byte latchPin)
+    {
+      m_bus = &bus;
+      m_latchPin = latchPin;
+      for (byte i=0;i<RINGS;i++) m_rings[i].encoder = NULL;
+      for (byte i=0;i<sizeof(m_patterns);i++) m_patterns[i] = 0;
+      m_dirty = true;
+      m_transfers = 0;
+    }
+
+    /**@brief
+     * Initializes the latch pin and clears all LEDs
+     */
+    void begin()
+    {
+      pinMode(m_latchPin, OUTPUT);
+      digitalWrite(m_latchPin, LOW);
+      shiftOut();
+    }
+
+    /**@brief
+     * Binds a ring to a rotary encoder
+     *
+     * @param[in] ring Index of the ring (0 is the ring on the first 74HC595 after the MCU)
+     * @param[in] encoder Rotary encoder
+     * @param[in] mode KY040LedRing::DOT, KY040LedRing::BAR or KY040LedRing::WRAP
+     * @param[in] minPosition Position for the first LED (not used for KY040LedRing::WRAP)
+     * @param[in] maxPosition Position for the last LED (not used for KY040LedRing::WRAP)
+     */
+    void attach(byte ring, KY040 &encoder, byte mode, int minPosition = 0, int maxPosition = LEDS - 1)
+    {
+      ringData &data = m_rings[ring];
+      data.encoder = &encoder;
+      data.mode = mode;
+      data.minPosition = minPosition;
+      data.maxPosition = maxPosition;
+      data.position = encoder.getPosition();
+      calculate(ring);
+    }
+
+    /**@brief
+     * Recalculates the patterns for changed positions and shifts out the chain, when a pattern has changed (Do not use inside ISR)
+     *
+     * @retval true Chain was shifted out
+     * @retval false Nothing has changed
+     */
+    bool update()
+    {
+      for (byte i=0;i<RINGS;i++) {
+        ringData &data = m_rings[i];
+        if (data.encoder == NULL) continue;
+        int position = data.encoder->getPosition();
+        if (position == data.position) continue;
+        data.position = position;
+        calculate(i);
+      }
+      if (!m_dirty) return false;
+      shiftOut();
+      return true;
+    }
+
+    /**@brief
+     * Get number of chain transfers
+     *
+     * @returns Number of times the chain was shifted out
+     */
+    unsigned long getTransferCount()
+    {
+      return m_transfers;
+    }
+  private:
+    // Calculates the pattern of a ring and marks the chain as dirty, when a byte has changed
+    void calculate(byte ring)
+    {
+      ringData &data = m_rings[ring];
+      int led;
+      if (data.mode == WRAP) {
+        led = data.position % LEDS;
+        if (led < 0) led += LEDS;
+      } else {
+        long position = constrain(data.position, data.minPosition, data.maxPosition);
+        long range = (long) data.maxPosition - data.minPosition;
+        led = (range > 0) ? ((position - data.minPosition) * (LEDS - 1)) / range : 0;
+      }
+      byte *pattern = &m_patterns[ring * (LEDS / 8)];
+      for (byte i=0;i<LEDS/8;i++) {
+        byte value = 0;
+        for (byte j=0;j<8;j++) {
+          int current = i*8 + j;
+          if ((current == led) || ((data.mode == BAR) && (current < led))) value |= 1 << j;
+        }
+        if (pattern[i] != value) {
+          pattern[i] = value;
+          m_dirty = true;
+        }
+      }
+    }
+
+    // Shifts out the whole chain, the last byte first, and latches it
+    void shiftOut()
+    {
+      for (int i=sizeof(m_patterns)-1;i>=0;i--) m_bus->transfer(m_patterns[i]);
+      digitalWrite(m_latchPin, HIGH);
+      digitalWrite(m_latchPin, LOW);
+      m_dirty = false;
+      m_transfers++;
+    }
+
+    struct ringData {
+      KY040 *encoder;
+      byte mode;
+      int minPosition;
+      int maxPosition;
+      int position; // Position of the current pattern
+    };
+
+    BUS *m_bus;
+    byte m_latchPin;
+    ringData m_rings[RINGS];
+    byte m_patterns[RINGS * (LEDS / 8)];
+    bool m_dirty;
+    unsigned long m_transfers;
+};
@@ -0,0 +1,172 @@
+/**
+ * Class: KY040Matrix
+ *
+ * Description:
+ * Scans many rotary encoders in a diode matrix like a keyboard matrix.
+ * The rotary encoders are grouped, each group has its own strobe output and
+ * all groups share the same CLK/DT return lines. With G groups of N rotary
+ * encoders only G + 2*N pins are needed (for example 8 + 8 pins for 32 rotary
+ * encoders instead of 64 pins).
+ *
+ * Wiring: Use bare rotary encoders (KY-040 modules have their own pull up
+ * resistors and connect the common pin to ground). The common pin of each
+ * rotary encoder is connected to the strobe line of its group, CLK and DT each
+ * via a diode (cathode to the rotary encoder) to the return lines. The return
+ * lines use INPUT_PULLUP. The selected group has its strobe line LOW, all other
+ * strobe lines are HIGH and their diodes block.
+ *
+ * scan() is meant for a timer ISR and reads one group per call. The next group
+ * is selected at the end of scan(), so the lines can settle until the next timer
+ * tick. Each group is scanned with the timer rate / number of groups. When the
+ * lines need longer to settle than the timer period (for example long cables),
+ * set settleMicros: scan() then waits only for the rest of this time since the
+ * group was selected.
+ * Do not call KY040::begin() for the rotary encoders of the matrix, because
+ * their return lines are shared.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Matrix.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Class for scanning KY040 rotary encoders in a diode matrix */
+class KY040Matrix {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] strobePins Array of digital output pins, one for each group
+     * @param[in] groups Number of groups
+     * @param[in] clkPins Array of digital input pins for the shared CLK return lines, one for each rotary encoder of a group
+     * @param[in] dtPins Array of digital input pins for the shared DT return lines, one for each rotary encoder of a group
+     * @param[in] encodersPerGroup Number of rotary encoders in each group
+     * @param[in] encoders Array of groups * encodersPerGroup rotary encoders (first all rotary encoders of group 0, then group 1 ...)
+     * @param[in] settleMicros Minimum time in microseconds between selecting a group and reading the return lines (0 = no wait, the lines settle until the next scan)
+     */
+    KY040Matrix(const byte strobePins[], byte groups, const byte clkPins[], const byte dtPins[], byte encodersPerGroup, KY040 encoders[], unsigned int settleMicros = 0)
+    {
+      m_strobePins = strobePins;
+      m_groups = groups;
+      m_clkPins = clkPins;
+      m_dtPins = dtPins;
+      m_encodersPerGroup = encodersPerGroup;
+      m_encoders = encoders;
+      m_settleMicros = settleMicros;
+      m_group = 0;
+      m_selectMicros = 0;
+      v_scans = 0;
+      v_lastScanMicros = 0;
+      v_maxScanMicros = 0;
+    }
+
+    /**@brief
+     * Initializes the pins and selects the first group. Call it in setup() before starting the timer.
+     */
+    void begin()
+    {
+      for (byte i=0;i<m_groups;i++) {
+        pinMode(m_strobePins[i], OUTPUT);
+        digitalWrite(m_strobePins[i], HIGH);
+      }
+      for (byte i=0;i<m_encodersPerGroup;i++) {
+        pinMode(m_clkPins[i], INPUT_PULLUP);
+        pinMode(m_dtPins[i], INPUT_PULLUP);
+      }
+      m_group = 0;
+      digitalWrite(m_strobePins[0], LOW);
+      m_selectMicros = KY040_MICROS();
+    }
+
+    /**@brief
+     * Reads and decodes the selected group and selects the next group. Should be called from a timer ISR.
+     */
+    void scan()
+    {
+      unsigned long startMicros = KY040_MICROS();
+      // Wait only, when the group was selected for less than the settle time (a delay in each scan would delay the next selection too)
+      unsigned long selectedMicros = startMicros - m_selectMicros;
+      if (selectedMicros < m_settleMicros) delayMicroseconds(m_settleMicros - selectedMicros);
+
+      KY040 *encoder = &m_encoders[m_group * m_encodersPerGroup];
+      for (byte i=0;i<m_encodersPerGroup;i++) {
+        encoder[i].setState((digitalRead(m_clkPins[i])<<1)+digitalRead(m_dtPins[i]));
+        encoder[i].checkRotation(); // Position is updated by the library
+      }
+
+      // Select next group, it settles until the next scan
+      digitalWrite(m_strobePins[m_group], HIGH);
+      if (++m_group >= m_groups) m_group = 0;
+      digitalWrite(m_strobePins[m_group], LOW);
+      m_selectMicros = KY040_MICROS();
+
+      unsigned long scanMicros = m_selectMicros - startMicros;
+      v_lastScanMicros = scanMicros;
+      if (scanMicros > v_maxScanMicros) v_maxScanMicros = scanMicros;
+      v_scans++;
+    }
+
+    /**@brief
+     * Get and reset the number of group scans since the last call (Do not use inside ISR)
+     *
+     * Divide by the elapsed time and the number of groups to get the scan rate of each rotary encoder
+     *
+     * @returns Number of calls of scan()
+     */
+    unsigned long getAndResetScanCount()
+    {
+      cli();
+      unsigned long result = v_scans;
+      v_scans = 0;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get duration of the last scan() (Do not use inside ISR)
+     *
+     * @returns Microseconds for reading and decoding one group
+     */
+    unsigned int getLastScanMicros()
+    {
+      cli();
+      unsigned int result = v_lastScanMicros;
+      sei();
+      return result;
+    }
+
+    /**@brief
+     * Get and reset the longest duration of scan() (Do not use inside ISR)
+     *
+     * @returns Microseconds for reading and decoding one group
+     */
+    unsigned int getAndResetMaxScanMicros()
+    {
+      cli();
+      unsigned int result = v_maxScanMicros;
+      v_maxScanMicros = 0;
+      sei();
+      return result;
+    }
+  private:
+    const byte *m_strobePins;
+    byte m_groups;
+    const byte *m_clkPins;
+    const byte *m_dtPins;
+    byte m_encodersPerGroup;
+    KY040 *m_encoders;
+    unsigned int m_settleMicros;
+    byte m_group; // Selected group
+    unsigned long m_selectMicros; // Time of the selection of m_group
+    volatile unsigned long v_scans;
+    volatile unsigned int v_lastScanMicros;
+    volatile unsigned int v_maxScanMicros;
+};
@@ -0,0 +1,172 @@
+/**
+ * Class: KY040Midi
+ *
+ * Description:
+ * MIDI output for KY040 rotary encoders with relative Control Change messages.
+ * Instead of one 3-byte Control Change per step, all steps of a rotary encoder
+ * since the last message are merged into one relative value, and the status byte
+ * is omitted for consecutive messages with the same status (running status).
+ * This keeps a 31250 baud MIDI link usable during fast rotations.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Midi.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Max number of rotary encoders for one KY040Midi */
+#define KY040MIDIMAXENCODERS 8
+/** Largest relative value in one message */
+#define KY040MIDIMAXDELTA 63
+/** Resend the status byte after this time in milliseconds, so that a receiver connected later can sync */
+#define KY040MIDIRUNNINGSTATUSMS 1000
+
+/** Class for MIDI relative Control Change output of KY-040 rotary encoders */
+class KY040Midi {
+  public:
+    /** Encodings for the relative value */
+    enum encodings
+    {
+      TWOSCOMPLEMENT, /**< 1..63 = +1..+63, 127..65 = -1..-63 */
+      OFFSET64, /**< 65..127 = +1..+63, 63..1 = -1..-63 */
+      SIGNMAGNITUDE /**< 1..63 = +1..+63, 65..127 = -1..-63 */
+    };
+
+    /**@brief
+     * Constructor
+     *
+     * @param[in] out Output for the MIDI bytes, for example Serial with 31250 baud
+     * @param[in] encoding KY040Midi::TWOSCOMPLEMENT, KY040Midi::OFFSET64 or KY040Midi::SIGNMAGNITUDE
+     * @param[in] intervalMillis Minimum time between two messages of the same rotary encoder. Steps in this time are merged into one message
+     */
+    KY040Midi(Print &out, byte encoding, unsigned int intervalMillis)
+    {
+      m_out = &out;
+      m_encoding = encoding;
+      m_intervalMillis = intervalMillis;
+      m_count = 0;
+      m_runningStatus = 0;
+      m_runningStatusMillis = 0;
+      m_messages = 0;
+      m_bytes = 0;
+    }
+
+    /**@brief
+     * Attach a rotary encoder
+     *
+     * @param[in] encoder Rotary encoder
+     * @param[in] channel MIDI channel 0..15
+     * @param[in] controller Controller number 0..127
+     *
+     * @retval true Rotary encoder was attached
+     * @retval false Too many rotary encoders (KY040MIDIMAXENCODERS)
+     */
+    bool attach(KY040 &encoder, byte channel, byte controller)
+    {
+      if (m_count >= KY040MIDIMAXENCODERS) return false;
+      m_encoders[m_count].encoder = &encoder;
+      m_encoders[m_count].status = 0xB0 | (channel & 0x0F);
+      m_encoders[m_count].controller = controller & 0x7F;
+      m_encoders[m_count].lastPosition = encoder.getPosition();
+      m_encoders[m_count].lastMillis = 0;
+      m_count++;
+      return true;
+    }
+
+    /**@brief
+     * Sends one Control Change for each rotary encoder with steps since its last message (Do not use inside ISR)
+     *
+     * Call it frequently in your loop. Steps beyond KY040MIDIMAXDELTA are sent with the next call.
+     */
+    void update()
+    {
+      unsigned long currentMillis = KY040_MILLIS();
+      for (byte i=0;i<m_count;i++) {
+        encoderData &data = m_encoders[i];
+        if (currentMillis - data.lastMillis < m_intervalMillis) continue;
+        int delta = data.encoder->getPosition() - data.lastPosition;
+        if (delta == 0) continue;
+        if (delta > KY040MIDIMAXDELTA) delta = KY040MIDIMAXDELTA;
+        if (delta < -KY040MIDIMAXDELTA) delta = -KY040MIDIMAXDELTA;
+        data.lastPosition += delta;
+        data.lastMillis = currentMillis;
+
+        if ((data.status != m_runningStatus) || (currentMillis - m_runningStatusMillis >= KY040MIDIRUNNINGSTATUSMS)) {
+          m_out->write(data.status);
+          m_bytes++;
+          m_runningStatus = data.status;
+          m_runningStatusMillis = currentMillis;
+        }
+        m_out->write(data.controller);
+        m_out->write(encode(delta));
+        m_bytes += 2;
+        m_messages++;
+      }
+    }
+
+    /**@brief
+     * Forces the status byte for the next message, for example after sending other MIDI messages to the same output
+     */
+    void resetRunningStatus()
+    {
+      m_runningStatus = 0;
+    }
+
+    /**@brief
+     * Get number of sent Control Change messages
+     *
+     * @returns Number of messages
+     */
+    unsigned long getMessageCount()
+    {
+      return m_messages;
+    }
+
+    /**@brief
+     * Get number of sent bytes
+     *
+     * @returns Number of bytes
+     */
+    unsigned long getByteCount()
+    {
+      return m_bytes;
+    }
+  private:
+    byte encode(int delta)
+    {
+      switch (m_encoding) {
+        case OFFSET64:
+          return 64 + delta;
+        case SIGNMAGNITUDE:
+          return (delta < 0) ? (0x40 | -delta) : delta;
+        default: // TWOSCOMPLEMENT
+          return delta & 0x7F;
+      }
+    }
+
+    struct encoderData {
+      KY040 *encoder;
+      byte status;
+      byte controller;
+      int lastPosition; // Position sent with the last message
+      unsigned long lastMillis;
+    };
+
+    Print *m_out;
+    byte m_encoding;
+    unsigned int m_intervalMillis;
+    encoderData m_encoders[KY040MIDIMAXENCODERS];
+    byte m_count;
+    byte m_runningStatus;
+    unsigned long m_runningStatusMillis;
+    unsigned long m_messages;
+    unsigned long m_bytes;
+};
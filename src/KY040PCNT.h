@@ -0,0 +1,197 @@
+/**
+ * Class: KY040PCNT
+ *
+ * Description:
+ * KY-040 rotary encoder on a pulse counter unit (PCNT) of an ESP32. The PCNT
+ * counts all four CLK/DT edges of a step in hardware with a glitch filter, so
+ * there is no CPU load for each edge. The counter is only read on demand and
+ * in the ISR for the counter limit events (the counter is accumulated in
+ * software, when it reaches a limit and restarts with 0).
+ *
+ * Like KY040 a step is only counted, when the rotary encoder is back in its
+ * idle state (CLK and DT high): getPosition() reads the pins and the counter
+ * and moves the position only, when CLK/DT are idle. The counter value at
+ * the last idle state is the anchor for the next steps, so half turned steps
+ * or bounces at a detent never create phantom steps. When the counter has
+ * moved by no multiple of four between two idle states (for example an edge
+ * was filtered out), the steps are rounded and the anchor is realigned.
+ *
+ * Uses the legacy PCNT driver (driver/pcnt.h) of ESP-IDF 4.x / Arduino-ESP32 2.x.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040PCNT.h
+ */
+#pragma once
+
+#if defined(ESP32)
+#include <arduino.h>
+#include <driver/pcnt.h>
+
+/** Counter limit of the PCNT unit (counts, the counter restarts with 0 after reaching it) */
+#define KY040PCNTLIMIT 32000
+
+/** Class for KY-040 rotary encoders on an ESP32 pulse counter unit */
+class KY040PCNT {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] pinCLK Digital pin connected to CLK aka. A
+     * @param[in] pinDT Digital pin connected to DT aka. B
+     * @param[in] unit PCNT unit, for example PCNT_UNIT_0
+     * @param[in] filterValue Glitch filter in APB clock cycles (0 = disabled, max. 1023 = 12.8 microseconds at 80 MHz)
+     */
+    KY040PCNT(byte pinCLK, byte pinDT, pcnt_unit_t unit, uint16_t filterValue = 1023)
+    {
+      m_pinCLK = pinCLK;
+      m_pinDT = pinDT;
+      m_unit = unit;
+      m_filterValue = filterValue;
+      v_accumulated = 0;
+      m_anchor = 0;
+      m_position = 0;
+      m_realigned = 0;
+      portMUX_INITIALIZE(&m_mux);
+    }
+
+    /**@brief
+     * Configures the PCNT unit and starts counting. Call it in setup().
+     *
+     * @retval true Success
+     * @retval false PCNT configuration failed
+     */
+    bool begin()
+    {
+      // Clockwise edges count up: CLK falls with DT high or rises with DT low, ...
+      pcnt_config_t config = {};
+      config.pulse_gpio_num = m_pinCLK;
+      config.ctrl_gpio_num = m_pinDT;
+      config.pos_mode = PCNT_COUNT_DEC;
+      config.neg_mode = PCNT_COUNT_INC;
+      config.hctrl_mode = PCNT_MODE_KEEP;
+      config.lctrl_mode = PCNT_MODE_REVERSE;
+      config.counter_h_lim = KY040PCNTLIMIT;
+      config.counter_l_lim = -KY040PCNTLIMIT;
+      config.unit = m_unit;
+      config.channel = PCNT_CHANNEL_0;
+      if (pcnt_unit_config(&config) != ESP_OK) return false;
+      // ... DT rises with CLK high or falls with CLK low
+      config.pulse_gpio_num = m_pinDT;
+      config.ctrl_gpio_num = m_pinCLK;
+      config.pos_mode = PCNT_COUNT_INC;
+      config.neg_mode = PCNT_COUNT_DEC;
+      config.channel = PCNT_CHANNEL_1;
+      if (pcnt_unit_config(&config) != ESP_OK) return false;
+
+      if (m_filterValue > 0) {
+        pcnt_set_filter_value(m_unit, m_filterValue);
+        pcnt_filter_enable(m_unit);
+      } else pcnt_filter_disable(m_unit);
+
+      pcnt_event_enable(m_unit, PCNT_EVT_H_LIM);
+      pcnt_event_enable(m_unit, PCNT_EVT_L_LIM);
+      esp_err_t result = pcnt_isr_service_install(0);
+      if ((result != ESP_OK) && (result != ESP_ERR_INVALID_STATE)) return false; // Already installed by another unit is fine
+      if (pcnt_isr_handler_add(m_unit, limitISR, this) != ESP_OK) return false;
+
+      pcnt_counter_pause(m_unit);
+      pcnt_counter_clear(m_unit);
+      portENTER_CRITICAL(&m_mux);
+      v_accumulated = 0;
+      portEXIT_CRITICAL(&m_mux);
+      m_anchor = 0;
+      pcnt_counter_resume(m_unit);
+      return true;
+    }
+
+    /**@brief
+     * Get position in steps. Steps are only counted, when CLK/DT are in the idle state. (Do not use inside ISR)
+     *
+     * @returns Position
+     */
+    long getPosition()
+    {
+      long count;
+      bool idle;
+      // The pins must be idle for the same counter value before and after reading them
+      do {
+        count = getCount();
+        idle = (digitalRead(m_pinCLK) == HIGH) && (digitalRead(m_pinDT) == HIGH);
+      } while (count != getCount());
+      if (!idle) return m_position;
+
+      long difference = count - m_anchor;
+      if (difference == 0) return m_position;
+      if (difference % 4 != 0) m_realigned++;
+      // Round to full steps (three of four edges are a step with a filtered edge)
+      long steps = (difference >= 0) ? (difference + 1) / 4 : -((-difference + 1) / 4);
+      m_position += steps;
+      m_anchor = count;
+      return m_position;
+    }
+
+    /**@brief
+     * Sets the position (Do not use inside ISR)
+     *
+     * @param[in] position New position
+     */
+    void setPosition(long position)
+    {
+      m_position = position;
+    }
+
+    /**@brief
+     * Get hardware counter including the accumulated limit events (Do not use inside ISR)
+     *
+     * @returns Counted CLK/DT edges (four for each step, clockwise is positive)
+     */
+    long getCount()
+    {
+      int16_t counter = 0;
+      portENTER_CRITICAL(&m_mux);
+      pcnt_get_counter_value(m_unit, &counter);
+      long result = v_accumulated + counter;
+      portEXIT_CRITICAL(&m_mux);
+      return result;
+    }
+
+    /**@brief
+     * Get number of realigned anchors (Free running counter)
+     *
+     * @returns Number of idle states, where the counter had moved by no multiple of four since the last idle state
+     */
+    unsigned long getRealignedCount()
+    {
+      return m_realigned;
+    }
+  private:
+    // Counter has reached a limit and restarts with 0
+    static void IRAM_ATTR limitISR(void *arg)
+    {
+      KY040PCNT *encoder = (KY040PCNT *) arg;
+      uint32_t status = 0;
+      pcnt_get_event_status(encoder->m_unit, &status);
+      portENTER_CRITICAL_ISR(&encoder->m_mux);
+      if (status & PCNT_EVT_H_LIM) encoder->v_accumulated += KY040PCNTLIMIT;
+      if (status & PCNT_EVT_L_LIM) encoder->v_accumulated -= KY040PCNTLIMIT;
+      portEXIT_CRITICAL_ISR(&encoder->m_mux);
+    }
+
+    byte m_pinCLK;
+    byte m_pinDT;
+    pcnt_unit_t m_unit;
+    uint16_t m_filterValue;
+    volatile long v_accumulated; // Sum of the limit events
+    long m_anchor; // Count at the last idle state
+    long m_position;
+    unsigned long m_realigned;
+    portMUX_TYPE m_mux;
+};
+#endif
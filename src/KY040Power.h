@@ -0,0 +1,124 @@
+/**
+ * Class: KY040Power
+ *
+ * Description:
+ * Sleep mode selection for KY040 rotary encoders on AVR. Instead of running at
+ * full power while a CLK/DT sequence is running, the MCU sleeps in
+ * SLEEP_MODE_IDLE (timers keep running, so millis() and the sleep guard of
+ * readyForSleep() work), while any rotary encoder is in a running sequence or
+ * within the PREVENTSLEEPMS guard time. Otherwise the MCU sleeps in a deep
+ * sleep mode (for example SLEEP_MODE_PWR_SAVE or SLEEP_MODE_PWR_DOWN).
+ * Pin change interrupts wake the MCU from both modes.
+ *
+ * The time in each mode is accounted with millis(). In deep sleep modes
+ * Timer0 stops, so millis() does not advance and only the number of deep
+ * sleeps can be counted.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Power.h
+ */
+#pragma once
+
+#include <avr/sleep.h>
+#include "KY040.h"
+
+/** Class for graduated sleep modes for KY-040 rotary encoders (AVR only) */
+class KY040Power {
+  public:
+    /** Power modes */
+    enum modes
+    {
+      RUNNING, /**< MCU is awake */
+      LIGHTSLEEP, /**< SLEEP_MODE_IDLE */
+      DEEPSLEEP /**< Deep sleep mode from the constructor */
+    };
+
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoders Array of rotary encoders
+     * @param[in] count Number of rotary encoders in the array
+     * @param[in] deepSleepMode Sleep mode, when all rotary encoders are ready for sleep, for example SLEEP_MODE_PWR_SAVE
+     */
+    KY040Power(KY040 *encoders[], byte count, byte deepSleepMode)
+    {
+      m_encoders = encoders;
+      m_count = count;
+      m_deepSleepMode = deepSleepMode;
+      m_wakeupMillis = 0;
+      for (byte i=0;i<3;i++) {
+        m_millisInMode[i] = 0;
+        m_counts[i] = 0;
+      }
+    }
+
+    /**@brief
+     * Selects the sleep mode and sleeps until the next interrupt. Call it in your loop, when there is nothing else to do.
+     *
+     * @retval KY040Power::LIGHTSLEEP MCU has slept in SLEEP_MODE_IDLE
+     * @retval KY040Power::DEEPSLEEP MCU has slept in the deep sleep mode
+     */
+    byte sleep()
+    {
+      // Decide with disabled interrupts, because an edge between the check and sleeping could start a sequence during deep sleep
+      cli();
+      unsigned long sleepMillis = KY040_MILLIS();
+      byte mode = DEEPSLEEP;
+      for (byte i=0;i<m_count;i++) {
+        if (!m_encoders[i]->readyForDeepSleep(sleepMillis)) {
+          mode = LIGHTSLEEP;
+          break;
+        }
+      }
+
+      m_millisInMode[RUNNING] += sleepMillis - m_wakeupMillis;
+      m_counts[mode]++;
+      set_sleep_mode((mode == LIGHTSLEEP) ? SLEEP_MODE_IDLE : m_deepSleepMode);
+      sleep_enable();
+      sei(); // The instruction after sei() is executed before a pending interrupt, so the interrupt wakes up the MCU from sleep_cpu()
+      sleep_cpu();
+      sleep_disable();
+      m_wakeupMillis = KY040_MILLIS();
+      m_millisInMode[mode] += m_wakeupMillis - sleepMillis;
+      m_counts[RUNNING]++; // Wakeups
+      return mode;
+    }
+
+    /**@brief
+     * Get milliseconds spent in a mode (measured with millis(), the time in deep sleep is not included, because millis() stops. Use getCount() for deep sleeps)
+     *
+     * @param[in] mode KY040Power::RUNNING, KY040Power::LIGHTSLEEP or KY040Power::DEEPSLEEP
+     *
+     * @returns Milliseconds
+     */
+    unsigned long getMillisInMode(byte mode)
+    {
+      return m_millisInMode[mode];
+    }
+
+    /**@brief
+     * Get number of sleeps in a mode
+     *
+     * @param[in] mode KY040Power::LIGHTSLEEP, KY040Power::DEEPSLEEP or KY040Power::RUNNING (number of wakeups)
+     *
+     * @returns Number of sleeps
+     */
+    unsigned long getCount(byte mode)
+    {
+      return m_counts[mode];
+    }
+  private:
+    KY040 **m_encoders;
+    byte m_count;
+    byte m_deepSleepMode;
+    unsigned long m_wakeupMillis;
+    unsigned long m_millisInMode[3];
+    unsigned long m_counts[3];
+};
@@ -0,0 +1,400 @@
+/**
+ * Class: KY040SyncEncoder, KY040SyncDecoder
+ *
+ * Description:
+ * Compact state sync frames for mirroring the positions of many KY040 rotary
+ * encoders on a remote device (for example a HMI over a serial line or radio).
+ * Sending only step events fails, when one event is lost, and sending the full
+ * state each time is wasteful. KY040SyncEncoder sends the positions, which
+ * have changed since the last frame acknowledged by the receiver. Because each
+ * frame is relative to an acknowledged frame, a lost frame does not corrupt
+ * the mirror: The next frame contains the changes again.
+ *
+ * Frame format (all frames start with the frame type and a sequence number):
+ * @code
+ * Keyframe: 'K' sequence value[0] ... value[N-1]
+ * Delta:    'D' sequence baseSequence bitmap value[i] for each set bit
+ * @endcode
+ * Keyframe values are the positions, delta values are the differences to the
+ * positions of the frame baseSequence. Values are zigzag encoded varints
+ * (7 bits per byte, small differences need one byte). The bitmap has one bit
+ * for each rotary encoder (bit 0 of the first byte for the first encoder).
+ * A keyframe is sent, when no usable acknowledged frame exists and
+ * periodically, so a receiver can join at any time. Keyframes are accepted
+ * even with an older sequence number, so a restarted sender is synced again.
+ *
+ * Example for 16 rotary encoders, a frame each 50 ms, one or two rotary
+ * encoders turned at the same time with about 10 steps per second and a
+ * keyframe each second: about 85..90 bytes per second with 0..20% lost frames
+ * instead of about 580 bytes per second for full state frames (a keyframe in
+ * each frame). The numbers are from extras/host/syncSimulation.cpp.
+ *
+ * KY040SyncDecoder has no dependencies to Arduino and can be used on the
+ * receiver or a PC with the same header. Send the sequence number of each
+ * decoded frame back to the sender with KY040SyncEncoder::acknowledge().
+ * Use the same HISTORY for both sides.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Sync.h
+ */
+#pragma once
+
+#if defined(ARDUINO)
+#include "KY040.h"
+#else
+#include <stddef.h>
+#include "KY040Directions.h"
+#endif
+
+/** Frame type for a frame with all positions */
+#define KY040SYNCKEYFRAME 'K'
+/** Frame type for a frame with the changed positions */
+#define KY040SYNCDELTA 'D'
+/** Maximum size of a frame in bytes for a number of rotary encoders (header, change bitmap and a varint for each position) */
+#define KY040SYNCMAXFRAMESIZE(encoders) (3 + ((encoders)+7)/8 + 5*(encoders))
+
+/** Frame coding for KY040SyncEncoder and KY040SyncDecoder */
+class KY040Sync {
+  protected:
+    // Zigzag encoding: 0,-1,1,-2,2... => 0,1,2,3,4...
+    static unsigned long toZigzag(long value)
+    {
+      return (value < 0) ? ~((unsigned long) value << 1) : ((unsigned long) value << 1);
+    }
+
+    static long fromZigzag(unsigned long value)
+    {
+      return (value & 1) ? (long) ~(value >> 1) : (long) (value >> 1);
+    }
+
+    // Writes a varint and returns the number of bytes
+    static size_t putVarint(byte *frame, unsigned long value)
+    {
+      size_t size = 0;
+      while (value >= 0x80) {
+        frame[size++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+      }
+      frame[size++] = value;
+      return size;
+    }
+
+    // Reads a varint and returns the number of bytes (0 = incomplete or too long)
+    static size_t getVarint(const byte *frame, size_t size, unsigned long &value)
+    {
+      value = 0;
+      for (size_t i=0;(i<size) && (i<5);i++) {
+        value |= (unsigned long) (frame[i] & 0x7F) << (7*i);
+        if (!(frame[i] & 0x80)) return i+1;
+      }
+      return 0;
+    }
+};
+
+#if defined(ARDUINO)
+/**
+ * Sender of state sync frames for KY-040 rotary encoders
+ *
+ * @tparam ENCODERS Number of rotary encoders
+ * @tparam HISTORY Number of sent frames, which can be acknowledged (power of two)
+ */
+template <byte ENCODERS, byte HISTORY = 4>
+class KY040SyncEncoder : public KY040Sync {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoders Array of ENCODERS rotary encoders
+     * @param[in] keyframeMillis Time between two keyframes in milliseconds (also sent without changes as heartbeat)
+     * @param[in] resendMillis Time in milliseconds to send an unacknowledged frame again
+     */
+    KY040SyncEncoder(KY040 *encoders[], unsigned long keyframeMillis, unsigned long resendMillis)
+    {
+      m_encoders = encoders;
+      m_keyframeMillis = keyframeMillis;
+      m_resendMillis = resendMillis;
+      m_sequence = 0;
+      m_baseSequence = 0;
+      m_baseValid = false;
+      m_keyframeNeeded = true;
+      m_lastFrameMillis = 0;
+      m_lastKeyframeMillis = 0;
+      m_frames = 0;
+      m_keyframes = 0;
+      m_bytes = 0;
+      for (byte i=0;i<HISTORY;i++) {
+        for (byte j=0;j<ENCODERS;j++) m_history[i][j] = 0;
+      }
+    }
+
+    /**@brief
+     * Creates a frame, when a position has changed, an unacknowledged frame has to be resent or a keyframe is due (Do not use inside ISR)
+     *
+     * @param[out] frame Buffer with at least KY040SYNCMAXFRAMESIZE(ENCODERS) bytes
+     *
+     * @returns Size of the frame in bytes (0 = nothing to send)
+     */
+    size_t encode(byte frame[])
+    {
+      int positions[ENCODERS];
+      bool changed = false;
+      const int *sent = m_history[m_sequence % HISTORY];
+      for (byte i=0;i<ENCODERS;i++) {
+        positions[i] = m_encoders[i]->getPosition();
+        if (positions[i] != sent[i]) changed = true;
+      }
+      unsigned long currentMillis = KY040_MILLIS();
+      bool keyframe = m_keyframeNeeded || (currentMillis - m_lastKeyframeMillis >= m_keyframeMillis);
+      bool resend = (!m_baseValid || (m_baseSequence != m_sequence)) && (currentMillis - m_lastFrameMillis >= m_resendMillis);
+      if (!changed && !keyframe && !resend) return 0;
+
+      byte sequence = m_sequence + 1;
+      // A delta needs an acknowledged frame, which the receiver still has in its history
+      if (!m_baseValid || ((byte) (sequence - m_baseSequence) >= HISTORY)) keyframe = true;
+
+      size_t size = 0;
+      frame[size++] = keyframe ? KY040SYNCKEYFRAME : KY040SYNCDELTA;
+      frame[size++] = sequence;
+      if (keyframe) {
+        for (byte i=0;i<ENCODERS;i++) size += putVarint(&frame[size], toZigzag(positions[i]));
+        m_lastKeyframeMillis = currentMillis;
+        m_keyframeNeeded = false;
+        m_keyframes++;
+      } else {
+        const int *base = m_history[m_baseSequence % HISTORY];
+        frame[size++] = m_baseSequence;
+        byte *bitmap = &frame[size];
+        for (byte i=0;i<(ENCODERS+7)/8;i++) bitmap[i] = 0;
+        size += (ENCODERS+7)/8;
+        for (byte i=0;i<ENCODERS;i++) {
+          if (positions[i] == base[i]) continue;
+          bitmap[i/8] |= 1 << (i%8);
+          size += putVarint(&frame[size], toZigzag((long) positions[i] - base[i]));
+        }
+      }
+
+      // Keep the positions as possible base for following deltas
+      m_sequence = sequence;
+      int *snapshot = m_history[sequence % HISTORY];
+      for (byte i=0;i<ENCODERS;i++) snapshot[i] = positions[i];
+      m_lastFrameMillis = currentMillis;
+      m_frames++;
+      m_bytes += size;
+      return size;
+    }
+
+    /**@brief
+     * Processes an acknowledge of the receiver. Following frames are deltas to this frame.
+     *
+     * @param[in] sequence Sequence number of the decoded frame (KY040SyncDecoder::getSequence())
+     */
+    void acknowledge(byte sequence)
+    {
+      byte age = m_sequence - sequence;
+      if (age >= HISTORY) return; // Unknown or too old
+      if (m_baseValid && ((byte) (m_sequence - m_baseSequence) < age)) return; // Older than the current base
+      m_baseSequence = sequence;
+      m_baseValid = true;
+    }
+
+    /**@brief
+     * Sends a keyframe with the next call of encode(), for example when the receiver has restarted
+     */
+    void requestKeyframe()
+    {
+      m_keyframeNeeded = true;
+      m_baseValid = false;
+    }
+
+    /**@brief
+     * Get number of sent frames
+     *
+     * @returns Number of frames
+     */
+    unsigned long getFrameCount()
+    {
+      return m_frames;
+    }
+
+    /**@brief
+     * Get number of sent keyframes
+     *
+     * @returns Number of keyframes
+     */
+    unsigned long getKeyframeCount()
+    {
+      return m_keyframes;
+    }
+
+    /**@brief
+     * Get number of sent bytes
+     *
+     * @returns Sum of the sizes of all frames
+     */
+    unsigned long getByteCount()
+    {
+      return m_bytes;
+    }
+  private:
+    KY040 **m_encoders;
+    unsigned long m_keyframeMillis;
+    unsigned long m_resendMillis;
+    byte m_sequence; // Sequence number of the last frame
+    byte m_baseSequence; // Sequence number of the last acknowledged frame
+    bool m_baseValid;
+    bool m_keyframeNeeded;
+    unsigned long m_lastFrameMillis;
+    unsigned long m_lastKeyframeMillis;
+    unsigned long m_frames;
+    unsigned long m_keyframes;
+    unsigned long m_bytes;
+    int m_history[HISTORY][ENCODERS]; // Positions of the last HISTORY frames (index sequence % HISTORY)
+};
+#endif
+
+/**
+ * Receiver of state sync frames for KY-040 rotary encoders (no Arduino dependencies)
+ *
+ * @tparam ENCODERS Number of rotary encoders
+ * @tparam HISTORY Number of decoded frames, which can be the base of a delta
+ */
+template <byte ENCODERS, byte HISTORY = 4>
+class KY040SyncDecoder : public KY040Sync {
+  public:
+    /**@brief
+     * Constructor
+     */
+    KY040SyncDecoder()
+    {
+      m_last = 0;
+      m_valid = false;
+      m_rejected = 0;
+      for (byte i=0;i<HISTORY;i++) m_states[i].valid = false;
+    }
+
+    /**@brief
+     * Decodes a frame
+     *
+     * @param[in] frame Frame
+     * @param[in] size Size of the frame in bytes
+     *
+     * @retval true Frame was decoded, send getSequence() as acknowledge
+     * @retval false Frame was rejected (corrupt, old, duplicate or unknown base)
+     */
+    bool decode(const byte frame[], size_t size)
+    {
+      if (size < 2) return reject();
+      byte type = frame[0];
+      byte sequence = frame[1];
+      bool restart = false;
+      if (m_valid) {
+        byte distance = sequence - m_states[m_last].sequence;
+        if (distance == 0) return reject(); // Duplicate
+        if (distance >= 128) { // Old frame or restarted sender
+          if (type != KY040SYNCKEYFRAME) return reject();
+          restart = true;
+        }
+      }
+      long positions[ENCODERS];
+      size_t offset = 2;
+      unsigned long value;
+      if (type == KY040SYNCKEYFRAME) {
+        for (byte i=0;i<ENCODERS;i++) {
+          size_t length = getVarint(&frame[offset], size - offset, value);
+          if (length == 0) return reject();
+          positions[i] = fromZigzag(value);
+          offset += length;
+        }
+      } else if (type == KY040SYNCDELTA) {
+        if (size < 3 + (ENCODERS+7)/8) return reject();
+        const state *base = find(frame[2]);
+        if (base == NULL) return reject();
+        const byte *bitmap = &frame[3];
+        offset = 3 + (ENCODERS+7)/8;
+        for (byte i=0;i<ENCODERS;i++) {
+          positions[i] = base->positions[i];
+          if (!(bitmap[i/8] & (1 << (i%8)))) continue;
+          size_t length = getVarint(&frame[offset], size - offset, value);
+          if (length == 0) return reject();
+          positions[i] += fromZigzag(value);
+          offset += length;
+        }
+      } else return reject();
+      if (offset != size) return reject();
+
+      if (restart) { // Sequence numbers of the older frames are not comparable anymore
+        for (byte i=0;i<HISTORY;i++) m_states[i].valid = false;
+      }
+      if (m_valid) m_last = (m_last + 1) % HISTORY;
+      state &current = m_states[m_last];
+      current.sequence = sequence;
+      current.valid = true;
+      for (byte i=0;i<ENCODERS;i++) current.positions[i] = positions[i];
+      m_valid = true;
+      return true;
+    }
+
+    /**@brief
+     * Get sequence number of the last decoded frame
+     *
+     * @returns Sequence number for KY040SyncEncoder::acknowledge()
+     */
+    byte getSequence()
+    {
+      return m_states[m_last].sequence;
+    }
+
+    /**@brief
+     * Get mirrored position
+     *
+     * @param[in] index Index of the rotary encoder
+     *
+     * @returns Position of the last decoded frame (0 before the first frame)
+     */
+    long getPosition(byte index)
+    {
+      return m_valid ? m_states[m_last].positions[index] : 0;
+    }
+
+    /**@brief
+     * Get number of rejected frames
+     *
+     * @returns Number of rejected frames
+     */
+    unsigned long getRejectedCount()
+    {
+      return m_rejected;
+    }
+  private:
+    struct state {
+      byte sequence;
+      bool valid;
+      long positions[ENCODERS];
+    };
+
+    bool reject()
+    {
+      m_rejected++;
+      return false;
+    }
+
+    const state *find(byte sequence)
+    {
+      for (byte i=0;i<HISTORY;i++) {
+        if (m_states[i].valid && (m_states[i].sequence == sequence)) return &m_states[i];
+      }
+      return NULL;
+    }
+
+    state m_states[HISTORY]; // Last HISTORY decoded frames
+    byte m_last; // Index of the last decoded frame
+    bool m_valid;
+    unsigned long m_rejected;
+};
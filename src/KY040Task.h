@@ -0,0 +1,192 @@
+/**
+ * Class: KY040Task
+ *
+ * Description:
+ * Decode task for KY040 rotary encoders on ESP32 (FreeRTOS). The GPIO ISR
+ * only stores the CLK/DT states with a timestamp in a queue, a dedicated task
+ * decodes them with setState() and checkRotation(). The task can be pinned to
+ * a core and get a higher priority than your other tasks, so decoding is not
+ * delayed by a busy loop() or WiFi/BT load on the other core. The time from
+ * the edge to the decoded state is recorded in a KY040Histogram, so different
+ * priorities and cores can be compared under load.
+ *
+ * When the queue is full, edges are dropped and counted. Because checkRotation()
+ * only accepts valid sequences, a dropped edge can lose a step, but never
+ * creates a wrong step.
+ *
+ * The decode task owns the KY040 objects. cli()/sei() in the KY040 methods
+ * only block interrupts on the own core, so they do not protect against the
+ * decode task on the other core. Read the positions and the latency histogram
+ * with the methods of KY040Task, which use a portMUX critical section and can
+ * be used from any core. Call methods of the KY040 objects directly only on
+ * the core of the decode task.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Task.h
+ */
+#pragma once
+
+#if defined(ESP32)
+#include "KY040.h"
+#include "KY040Histogram.h"
+
+/** Maximum number of rotary encoders for one decode task */
+#define KY040TASKMAXENCODERS 8
+
+/** Class for a FreeRTOS decode task for KY-040 rotary encoders (ESP32 only) */
+class KY040Task {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoders Array of rotary encoders
+     * @param[in] clkPins Array of the CLK pins of the rotary encoders
+     * @param[in] dtPins Array of the DT pins of the rotary encoders
+     * @param[in] count Number of rotary encoders (max. KY040TASKMAXENCODERS)
+     * @param[in] queueLength Number of edges, which can wait for the decode task
+     */
+    KY040Task(KY040 *encoders[], const byte clkPins[], const byte dtPins[], byte count, byte queueLength = 32)
+    {
+      m_encoders = encoders;
+      m_clkPins = clkPins;
+      m_dtPins = dtPins;
+      m_count = (count > KY040TASKMAXENCODERS) ? KY040TASKMAXENCODERS : count;
+      m_queueLength = queueLength;
+      m_queue = NULL;
+      m_task = NULL;
+      v_dropped = 0;
+      portMUX_INITIALIZE(&m_mux);
+      for (byte i=0;i<m_count;i++) {
+        m_sources[i].task = this;
+        m_sources[i].index = i;
+        m_positions[i] = 0;
+      }
+    }
+
+    /**@brief
+     * Creates the queue and the decode task and attaches the interrupts for CLK and DT. Call it in setup().
+     *
+     * @param[in] priority FreeRTOS priority of the decode task (loop() has priority 1)
+     * @param[in] core Core for the decode task (0 or 1, tskNO_AFFINITY = any)
+     * @param[in] stackSize Stack size of the decode task in bytes
+     *
+     * @retval true Success
+     * @retval false Queue or task could not be created
+     */
+    bool begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize = 2048)
+    {
+      m_queue = xQueueCreate(m_queueLength, sizeof(edge));
+      if (m_queue == NULL) return false;
+      if (xTaskCreatePinnedToCore(decodeTask, "KY040Task", stackSize, this, priority, &m_task, core) != pdPASS) return false;
+      for (byte i=0;i<m_count;i++) {
+        m_encoders[i]->begin();
+        attachInterruptArg(digitalPinToInterrupt(m_clkPins[i]), edgeISR, &m_sources[i], CHANGE);
+        attachInterruptArg(digitalPinToInterrupt(m_dtPins[i]), edgeISR, &m_sources[i], CHANGE);
+      }
+      return true;
+    }
+
+    /**@brief
+     * Get position of a rotary encoder. Can be used on any core. (Do not use inside ISR)
+     *
+     * @param[in] index Index of the rotary encoder
+     *
+     * @returns Position after the last decoded state
+     */
+    int getPosition(byte index)
+    {
+      if (index >= m_count) return 0;
+      portENTER_CRITICAL(&m_mux);
+      int result = m_positions[index];
+      portEXIT_CRITICAL(&m_mux);
+      return result;
+    }
+
+    /**@brief
+     * Copies the histogram of the microseconds from the edge to the decoded state. Can be used on any core. (Do not use inside ISR)
+     *
+     * @param[out] histogram Copy of the histogram
+     * @param[in] reset true = Clears the histogram of the task after copying, for example to compare configurations
+     */
+    void getLatencyHistogram(KY040Histogram &histogram, bool reset = false)
+    {
+      KY040Histogram empty; // Outside the critical section, because the constructor uses cli()/sei()
+      portENTER_CRITICAL(&m_mux);
+      histogram = m_latency;
+      if (reset) m_latency = empty;
+      portEXIT_CRITICAL(&m_mux);
+    }
+
+    /**@brief
+     * Get number of edges dropped because of a full queue (Free running counter)
+     *
+     * @returns Number of dropped edges
+     */
+    unsigned long getDroppedCount()
+    {
+      return v_dropped;
+    }
+  private:
+    struct edge {
+      unsigned long micros; // Time of the edge
+      byte index; // Index of the rotary encoder
+      byte state; // CLK/DT state
+    };
+
+    struct source {
+      KY040Task *task;
+      byte index;
+    };
+
+    // Stores the CLK/DT state with a timestamp for the decode task
+    static void IRAM_ATTR edgeISR(void *arg)
+    {
+      source *from = (source *) arg;
+      KY040Task *task = from->task;
+      edge event;
+      event.micros = micros();
+      event.index = from->index;
+      event.state = (digitalRead(task->m_clkPins[event.index])<<1) + digitalRead(task->m_dtPins[event.index]);
+      BaseType_t higherPriorityTaskWoken = pdFALSE;
+      if (xQueueSendFromISR(task->m_queue, &event, &higherPriorityTaskWoken) != pdTRUE) task->v_dropped++;
+      if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+    }
+
+    // Decodes the queued states
+    static void decodeTask(void *arg)
+    {
+      KY040Task *task = (KY040Task *) arg;
+      edge event;
+      for (;;) {
+        if (xQueueReceive(task->m_queue, &event, portMAX_DELAY) != pdTRUE) continue;
+        KY040 *encoder = task->m_encoders[event.index];
+        portENTER_CRITICAL(&task->m_mux);
+        encoder->setState(event.state);
+        encoder->checkRotation(); // Position is updated by the library
+        task->m_positions[event.index] = encoder->v_position;
+        task->m_latency.record(micros() - event.micros);
+        portEXIT_CRITICAL(&task->m_mux);
+      }
+    }
+
+    KY040 **m_encoders;
+    const byte *m_clkPins;
+    const byte *m_dtPins;
+    byte m_count;
+    byte m_queueLength;
+    QueueHandle_t m_queue;
+    TaskHandle_t m_task;
+    source m_sources[KY040TASKMAXENCODERS];
+    int m_positions[KY040TASKMAXENCODERS]; // Positions for other cores (protected by m_mux)
+    KY040Histogram m_latency; // Protected by m_mux
+    volatile unsigned long v_dropped;
+    portMUX_TYPE m_mux;
+};
+#endif
@@ -0,0 +1,230 @@
+/**
+ * Class: KY040TimerWheel, KY040Timer
+ *
+ * Description:
+ * Small hashed timer wheel for timeouts of many rotary encoders (for example
+ * "knob released" notifications or long press detection). Instead of
+ * comparing millis() for every rotary encoder and feature in each loop,
+ * timers are registered in the slot of their deadline and advance() only
+ * visits one slot per elapsed tick.
+ *
+ * Timers are owned by the sketch (no dynamic memory) and are linked into
+ * the wheel, so starting, restarting and stopping a timer is O(1).
+ * The wheel is not interrupt safe, use it only in your loop.
+ *
+ * KY040ReleaseTimer registers the "knob released" timeout of a rotary
+ * encoder with the wheel. The timeouts of the other library features
+ * (deadband settle time, KY040Midi, KY040Journal, KY040Adaptive, KY040Sync)
+ * are checked with a single time comparison in their own update functions
+ * or partly from ISR and do not use the wheel.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040TimerWheel.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Number of slots in the timer wheel (power of two) */
+#define KY040TIMERWHEELSLOTS 16
+/** Maximum delay of a timer in milliseconds (about 24.8 days), KY040TimerWheel::start() rejects longer delays */
+#define KY040TIMERWHEELMAXDELAY 0x7FFFFFFFUL
+
+/** Timer for the KY040TimerWheel */
+class KY040Timer {
+  public:
+    /**@brief
+     * Constructor of a timer
+     *
+     * @param[in] callback Function called from KY040TimerWheel::advance() when the timer has expired
+     * @param[in] context Pointer passed to the callback, for example the rotary encoder
+     */
+    KY040Timer(void (*callback)(void *context), void *context = NULL)
+    {
+      m_callback = callback;
+      m_context = context;
+      m_next = NULL;
+      m_prev = NULL;
+      m_rounds = 0;
+      m_active = false;
+      m_expired = false;
+    }
+
+    /**@brief
+     * Checks, if the timer is running
+     *
+     * @retval true Timer is running
+     * @retval false Timer is stopped or has expired
+     */
+    bool isActive()
+    {
+      return m_active;
+    }
+  private:
+    friend class KY040TimerWheel;
+    void (*m_callback)(void *context);
+    void *m_context;
+    KY040Timer *m_next;
+    KY040Timer *m_prev;
+    unsigned long m_rounds; // Remaining full turns of the wheel before expiry (16 bit would wrap after 17.5 minutes with 1 ms ticks)
+    byte m_slot;
+    bool m_active;
+    bool m_expired; // Expired in the current tick, but callback has not run
+};
+
+/** Hashed timer wheel for KY040Timer */
+class KY040TimerWheel {
+  public:
+    /**@brief
+     * Constructor of the timer wheel
+     *
+     * @param[in] tickMillis Resolution of the timers in milliseconds (0 is used as 1)
+     */
+    KY040TimerWheel(unsigned int tickMillis)
+    {
+      m_tickMillis = (tickMillis == 0) ? 1 : tickMillis; // Prevent division by zero in start() and an endless loop in advance()
+      m_lastTickMillis = 0;
+      m_currentSlot = 0;
+      m_started = false;
+      for (byte i=0;i<KY040TIMERWHEELSLOTS;i++) m_slots[i] = NULL;
+    }
+
+    /**@brief
+     * Starts or restarts a timer (Do not use inside ISR)
+     *
+     * The timer never expires early, but can expire up to one tick late (or later, when advance() is not called in time)
+     *
+     * @param[in] timer Timer
+     * @param[in] delayMillis Milliseconds until the timer expires (rounded up to the tick resolution, max. KY040TIMERWHEELMAXDELAY)
+     *
+     * @retval true Timer was started
+     * @retval false Delay is longer than KY040TIMERWHEELMAXDELAY, the timer is stopped
+     */
+    bool start(KY040Timer &timer, unsigned long delayMillis)
+    {
+      if (timer.m_active) unlink(timer);
+      if (delayMillis > KY040TIMERWHEELMAXDELAY) return false; // The sum for the ticks would overflow
+      sync();
+      // Ticks from the last processed tick, because the current tick has already started
+      unsigned long ticks = (KY040_MILLIS() - m_lastTickMillis + delayMillis + m_tickMillis - 1) / m_tickMillis;
+      if (ticks == 0) ticks = 1;
+      byte slot = (m_currentSlot + ticks) & (KY040TIMERWHEELSLOTS - 1);
+      timer.m_rounds = (ticks - 1) / KY040TIMERWHEELSLOTS;
+      timer.m_slot = slot;
+      timer.m_prev = NULL;
+      timer.m_next = m_slots[slot];
+      if (timer.m_next != NULL) timer.m_next->m_prev = &timer;
+      m_slots[slot] = &timer;
+      timer.m_active = true;
+      return true;
+    }
+
+    /**@brief
+     * Stops a timer (Do not use inside ISR)
+     *
+     * @param[in] timer Timer
+     */
+    void stop(KY040Timer &timer)
+    {
+      if (timer.m_active) unlink(timer);
+    }
+
+    /**@brief
+     * Advances the wheel by the ticks elapsed since the last call and runs the callbacks of expired timers (Do not use inside ISR)
+     *
+     * Call it frequently in your loop. Callbacks may start or stop timers.
+     */
+    void advance()
+    {
+      sync();
+      unsigned long currentMillis = KY040_MILLIS();
+      while (currentMillis - m_lastTickMillis >= m_tickMillis) {
+        m_lastTickMillis += m_tickMillis;
+        m_currentSlot = (m_currentSlot + 1) & (KY040TIMERWHEELSLOTS - 1);
+        // Mark expired timers first, so that callbacks can start or stop any timer
+        for (KY040Timer *timer = m_slots[m_currentSlot]; timer != NULL; timer = timer->m_next) {
+          if (timer->m_rounds == 0) timer->m_expired = true; else timer->m_rounds--;
+        }
+        KY040Timer *timer = m_slots[m_currentSlot];
+        while (timer != NULL) {
+          if (timer->m_expired) {
+            unlink(*timer);
+            timer->m_callback(timer->m_context);
+            timer = m_slots[m_currentSlot]; // Slot could have changed in the callback
+          } else timer = timer->m_next;
+        }
+      }
+    }
+  private:
+    // Starts the wheel time on first use, because millis() is not running when global objects are constructed
+    void sync()
+    {
+      if (m_started) return;
+      m_lastTickMillis = KY040_MILLIS();
+      m_started = true;
+    }
+    void unlink(KY040Timer &timer)
+    {
+      if (timer.m_prev != NULL) timer.m_prev->m_next = timer.m_next; else m_slots[timer.m_slot] = timer.m_next;
+      if (timer.m_next != NULL) timer.m_next->m_prev = timer.m_prev;
+      timer.m_next = NULL;
+      timer.m_prev = NULL;
+      timer.m_active = false;
+      timer.m_expired = false;
+    }
+    KY040Timer *m_slots[KY040TIMERWHEELSLOTS];
+    unsigned int m_tickMillis;
+    unsigned long m_lastTickMillis;
+    byte m_currentSlot;
+    bool m_started;
+};
+
+/**
+ * Timer for a "knob released" notification of a rotary encoder
+ *
+ * update() restarts the timer in the wheel, when the rotary encoder has finished a step since the last call. The callback
+ * is called from KY040TimerWheel::advance(), when no step was finished for the release time.
+ */
+class KY040ReleaseTimer : public KY040Timer {
+  public:
+    /**@brief
+     * Constructor of a release timer
+     *
+     * @param[in] encoder Rotary encoder
+     * @param[in] releaseMillis Milliseconds without a finished step until the callback is called (max. KY040TIMERWHEELMAXDELAY)
+     * @param[in] callback Function called from KY040TimerWheel::advance() when the rotary encoder was released
+     * @param[in] context Pointer passed to the callback
+     */
+    KY040ReleaseTimer(KY040 &encoder, unsigned long releaseMillis, void (*callback)(void *context), void *context = NULL) : KY040Timer(callback, context)
+    {
+      m_encoder = &encoder;
+      m_releaseMillis = releaseMillis;
+      m_stepCount = 0; // Step count of a new rotary encoder
+    }
+
+    /**@brief
+     * Restarts the timer, when the rotary encoder has finished a step since the last call (Do not use inside ISR)
+     *
+     * Call it in your loop before KY040TimerWheel::advance()
+     *
+     * @param[in] wheel Timer wheel
+     */
+    void update(KY040TimerWheel &wheel)
+    {
+      unsigned int stepCount = m_encoder->getStepCount();
+      if (stepCount == m_stepCount) return;
+      m_stepCount = stepCount;
+      wheel.start(*this, m_releaseMillis);
+    }
+  private:
+    KY040 *m_encoder;
+    unsigned long m_releaseMillis;
+    unsigned int m_stepCount; // Step count of the rotary encoder at the last update()
+};
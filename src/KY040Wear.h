@@ -0,0 +1,219 @@
+/**
+ * Class: KY040Wear
+ *
+ * Description:
+ * Lifetime counters and a wear trend estimator for a KY040 rotary encoder.
+ * Worn KY-040 contacts bounce more, so the number of rejected CLK/DT states and
+ * aborted sequences per finished step rises over the lifetime of the encoder.
+ *
+ * The estimator keeps the lifetime counters and two moving averages of the
+ * bounces per step over windows of steps: a short-term average (last ~4 windows)
+ * and a long-term average (last ~64 windows). Because an average lags behind a
+ * rising value by (1-alpha)/alpha windows, the difference of both averages
+ * divided by the difference of their lags is the trend per window. From the trend
+ * it predicts the remaining steps until a configured limit is reached.
+ * Everything is computed incrementally with integers in a few bytes of RAM.
+ *
+ * The state is saved and restored as KY040WearRecord. How the record is stored
+ * (for example round-robin in EEPROM slots to spread the writes) is up to your
+ * sketch, saveNeeded() tells when a save is useful.
+ *
+ * License: 2-Clause BSD License
+ * Copyright (c) 2024 codingABI
+ * For details see: LICENSE.txt
+ *
+ * Home: https://github.com/codingABI/KY040
+ *
+ * @author codingABI https://github.com/codingABI/
+ * @copyright 2-Clause BSD License
+ * @file KY040Wear.h
+ */
+#pragma once
+
+#include "KY040.h"
+
+/** Remaining steps returned by getRemainingSteps(), when no end of life can be predicted */
+#define KY040WEARUNKNOWN 0xFFFFFFFFUL
+// Lag in windows of the short-term (alpha = 1/4) and long-term (alpha = 1/64) moving average
+#define KY040WEARSHORTLAG 3
+#define KY040WEARLONGLAG 63
+
+/** Persistent state of KY040Wear */
+struct KY040WearRecord {
+  unsigned long steps; /**< Lifetime finished steps */
+  unsigned long rejected; /**< Lifetime rejected CLK/DT states */
+  unsigned long aborted; /**< Lifetime aborted sequences */
+  unsigned int bouncesPerStep; /**< Short-term moving average of (rejected + aborted) per step, fixed point 8.8 */
+  unsigned long longTermBouncesPerStep; /**< Long-term moving average of (rejected + aborted) per step, fixed point 16.16 */
+  unsigned int sequence; /**< Incremented on every getRecord(), to find the newest saved record */
+  byte checksum; /**< Checksum of all bytes before */
+};
+
+/** Class for lifetime counters and wear trend of a KY-040 rotary encoder */
+class KY040Wear {
+  public:
+    /**@brief
+     * Constructor
+     *
+     * @param[in] encoder Rotary encoder
+     * @param[in] windowSteps Number of finished steps in one window
+     * @param[in] limit Bounces per step (fixed point 8.8, for example 512 for 2.0), when the rotary encoder is considered as worn
+     * @param[in] saveWindows Number of windows between two saves
+     */
+    KY040Wear(KY040 &encoder, unsigned int windowSteps, unsigned int limit, unsigned int saveWindows)
+    {
+      m_encoder = &encoder;
+      m_windowSteps = windowSteps;
+      m_limit = limit;
+      m_saveWindows = saveWindows;
+      memset(&m_record, 0, sizeof(m_record));
+      m_windowBounces = 0;
+      m_windowStepCount = 0;
+      m_windows = 0;
+      m_started = false;
+    }
+
+    /**@brief
+     * Restores a saved record
+     *
+     * @param[in] record Saved record
+     *
+     * @retval true Record was valid and restored
+     * @retval false Checksum error, record was ignored
+     */
+    bool restore(const KY040WearRecord &record)
+    {
+      if (checksum(record) != record.checksum) return false;
+      m_record = record;
+      return true;
+    }
+
+    /**@brief
+     * Updates counters and trend from the rotary encoder (Do not use inside ISR)
+     *
+     * Call it in your loop at least every 65535 steps, bounces or sequences
+     */
+    void update()
+    {
+      unsigned int steps = m_encoder->getStepCount();
+      unsigned int rejected = m_encoder->getRejectedCount();
+      unsigned int aborted = m_encoder->getAbortedCount();
+      if (!m_started) { // Counters of the rotary encoder could already be running
+        m_lastSteps = steps;
+        m_lastRejected = rejected;
+        m_lastAborted = aborted;
+        m_started = true;
+        return;
+      }
+      unsigned int newSteps = steps - m_lastSteps;
+      unsigned int newRejected = rejected - m_lastRejected;
+      unsigned int newAborted = aborted - m_lastAborted;
+      m_lastSteps = steps;
+      m_lastRejected = rejected;
+      m_lastAborted = aborted;
+
+      m_record.steps += newSteps;
+      m_record.rejected += newRejected;
+      m_record.aborted += newAborted;
+      m_windowStepCount += newSteps;
+      m_windowBounces += (unsigned long) newRejected + newAborted;
+      if (m_windowStepCount < m_windowSteps) return;
+
+      // Window has finished
+      unsigned long ratio = (m_windowBounces << 8) / m_windowStepCount;
+      if (ratio > 0xFFFF) ratio = 0xFFFF;
+      m_windowBounces = 0;
+      m_windowStepCount = 0;
+      if (m_windows < 0xFFFF) m_windows++;
+      if ((m_record.bouncesPerStep == 0) && (m_record.longTermBouncesPerStep == 0)) { // No history, start both averages with this window
+        m_record.bouncesPerStep = ratio;
+        m_record.longTermBouncesPerStep = ratio << 8;
+        return;
+      }
+      long average = m_record.bouncesPerStep;
+      m_record.bouncesPerStep = average + (((long) ratio - average) >> 2);
+      long longTermAverage = m_record.longTermBouncesPerStep;
+      m_record.longTermBouncesPerStep = longTermAverage + ((((long) ratio << 8) - longTermAverage) >> 6);
+    }
+
+    /**@brief
+     * Get trend of bounces per step
+     *
+     * @returns Change of bounces per step for each window, fixed point 16.16
+     */
+    long getTrend()
+    {
+      return (((long) m_record.bouncesPerStep << 8) - (long) m_record.longTermBouncesPerStep) / (KY040WEARLONGLAG - KY040WEARSHORTLAG);
+    }
+
+    /**@brief
+     * Checks, if enough windows have passed since the last getRecord() to save the record
+     *
+     * @retval true Save the record now
+     * @retval false No save needed
+     */
+    bool saveNeeded()
+    {
+      return m_windows >= m_saveWindows;
+    }
+
+    /**@brief
+     * Get the record to save it
+     *
+     * @param[out] record Record with incremented sequence number and checksum
+     */
+    void getRecord(KY040WearRecord &record)
+    {
+      m_record.sequence++;
+      m_record.checksum = checksum(m_record);
+      m_windows = 0;
+      record = m_record;
+    }
+
+    /**@brief
+     * Get lifetime counters and averages without changing the sequence number
+     *
+     * @returns Record
+     */
+    const KY040WearRecord &getStatistics()
+    {
+      return m_record;
+    }
+
+    /**@brief
+     * Predicts the remaining steps until the limit for bounces per step is reached
+     *
+     * @returns Remaining steps, 0 when the limit is already reached, or KY040WEARUNKNOWN when the trend is not rising
+     */
+    unsigned long getRemainingSteps()
+    {
+      long average = m_record.bouncesPerStep;
+      if (average >= (long) m_limit) return 0;
+      long trend = getTrend();
+      if (trend <= 0) return KY040WEARUNKNOWN;
+      unsigned long windows = (((unsigned long) ((long) m_limit - average)) << 8) / (unsigned long) trend;
+      if (windows > KY040WEARUNKNOWN / m_windowSteps) return KY040WEARUNKNOWN - 1;
+      return windows * m_windowSteps;
+    }
+  private:
+    static byte checksum(const KY040WearRecord &record)
+    {
+      const byte *data = (const byte *) &record;
+      byte result = 0xA5;
+      for (byte i=0;i<offsetof(KY040WearRecord, checksum);i++) result = (result << 1 | result >> 7) ^ data[i];
+      return result;
+    }
+
+    KY040 *m_encoder;
+    KY040WearRecord m_record;
+    unsigned int m_windowSteps;
+    unsigned int m_limit;
+    unsigned int m_saveWindows;
+    unsigned int m_windows;
+    unsigned int m_windowStepCount;
+    unsigned long m_windowBounces;
+    unsigned int m_lastSteps;
+    unsigned int m_lastRejected;
+    unsigned int m_lastAborted;
+    bool m_started;
+};